@@ -0,0 +1,315 @@
+/*! \file archive.c
+ *  \brief Memory-mapped data archive, served to Allegro through custom file interface.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include <sys/types.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "archive.h"
+
+/*! \brief Mapped archive, NULL if there's none. */
+unsigned char *archive_data = NULL;
+/*! \brief Size of mapped archive. */
+size_t archive_size = 0;
+/*! \brief Number of entries in the archive. */
+unsigned int archive_count = 0;
+/*! \brief Table of entry names. */
+char *archive_names = NULL;
+/*! \brief File interface used for files outside of the archive. */
+const ALLEGRO_FILE_INTERFACE *archive_fallback = NULL;
+#ifdef _WIN32
+/*! \brief File mapping object backing the archive. */
+HANDLE archive_mapping = NULL;
+#endif
+
+/*! \brief State of a file opened through archive file interface. */
+struct ArchiveFile {
+		const unsigned char *data; /*!< Entry data in mapped archive, NULL if file is outside of the archive. */
+		int64_t size; /*!< Size of entry. */
+		int64_t pos; /*!< Current position in entry. */
+		bool eof; /*!< True after attempt to read past the end of entry. */
+		ALLEGRO_FILE *file; /*!< File opened with fallback interface, if it's outside of the archive. */
+};
+
+/*! \brief Reads 32-bit little endian number from mapped archive. */
+unsigned int ReadLE32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/*! \brief Returns index record of given data file, or NULL if archive doesn't contain it. */
+const unsigned char* FindEntry(const char* filename) {
+	int lo = 0, hi = (int)archive_count - 1;
+	if (!archive_data) return NULL;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		const unsigned char *record = archive_data + ARCHIVE_HEADER_SIZE + mid * ARCHIVE_RECORD_SIZE;
+		int cmp = strcmp(filename, archive_names + ReadLE32(record));
+		if (!cmp) return record;
+		if (cmp < 0) hi = mid - 1;
+		else lo = mid + 1;
+	}
+	return NULL;
+}
+
+void* ArchiveOpen(const char *path, const char *mode) {
+	struct ArchiveFile *f;
+	if (strncmp(path, ARCHIVE_PREFIX, strlen(ARCHIVE_PREFIX))) {
+		ALLEGRO_FILE *file = al_fopen_interface(archive_fallback, path, mode);
+		if (!file) return NULL;
+		f = calloc(1, sizeof(struct ArchiveFile));
+		f->file = file;
+		return f;
+	}
+	/* archive is mapped read-only */
+	if (strpbrk(mode, "wa+")) return NULL;
+	const unsigned char *record = FindEntry(path + strlen(ARCHIVE_PREFIX));
+	if (!record) return NULL;
+	f = calloc(1, sizeof(struct ArchiveFile));
+	f->data = archive_data + ReadLE32(record + 4);
+	f->size = ReadLE32(record + 8);
+	return f;
+}
+
+void ArchiveClose(ALLEGRO_FILE *handle) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) al_fclose(f->file);
+	free(f);
+}
+
+size_t ArchiveRead(ALLEGRO_FILE *handle, void *ptr, size_t size) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_fread(f->file, ptr, size);
+	if ((int64_t)size > f->size - f->pos) {
+		size = f->size - f->pos;
+		f->eof = true;
+	}
+	memcpy(ptr, f->data + f->pos, size);
+	f->pos += size;
+	return size;
+}
+
+size_t ArchiveWrite(ALLEGRO_FILE *handle, const void *ptr, size_t size) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_fwrite(f->file, ptr, size);
+	return 0;
+}
+
+bool ArchiveFlush(ALLEGRO_FILE *handle) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_fflush(f->file);
+	return true;
+}
+
+int64_t ArchiveTell(ALLEGRO_FILE *handle) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_ftell(f->file);
+	return f->pos;
+}
+
+bool ArchiveSeek(ALLEGRO_FILE *handle, int64_t offset, int whence) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_fseek(f->file, offset, whence);
+	if (whence == ALLEGRO_SEEK_CUR) offset += f->pos;
+	else if (whence == ALLEGRO_SEEK_END) offset += f->size;
+	if ((offset < 0) || (offset > f->size)) return false;
+	f->pos = offset;
+	f->eof = false;
+	return true;
+}
+
+bool ArchiveEOF(ALLEGRO_FILE *handle) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_feof(f->file);
+	return f->eof;
+}
+
+bool ArchiveError(ALLEGRO_FILE *handle) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_ferror(f->file);
+	return false;
+}
+
+void ArchiveClearError(ALLEGRO_FILE *handle) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) al_fclearerr(f->file);
+	else f->eof = false;
+}
+
+int ArchiveUngetc(ALLEGRO_FILE *handle, int c) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_fungetc(f->file, c);
+	/* mapped data can't be changed, so only the character just read can be pushed back */
+	if ((!f->pos) || (f->data[f->pos-1] != (unsigned char)c)) return EOF;
+	f->pos--;
+	f->eof = false;
+	return c;
+}
+
+off_t ArchiveSize(ALLEGRO_FILE *handle) {
+	struct ArchiveFile *f = al_get_file_userdata(handle);
+	if (f->file) return al_fsize(f->file);
+	return f->size;
+}
+
+/*! \brief File interface serving entries straight from mapped archive and passing other files to fallback interface. */
+const ALLEGRO_FILE_INTERFACE archive_interface = {
+	.fi_fopen = ArchiveOpen,
+	.fi_fclose = ArchiveClose,
+	.fi_fread = ArchiveRead,
+	.fi_fwrite = ArchiveWrite,
+	.fi_fflush = ArchiveFlush,
+	.fi_ftell = ArchiveTell,
+	.fi_fseek = ArchiveSeek,
+	.fi_feof = ArchiveEOF,
+	.fi_ferror = ArchiveError,
+	.fi_fclearerr = ArchiveClearError,
+	.fi_fungetc = ArchiveUngetc,
+	.fi_fsize = ArchiveSize
+};
+
+/*! \brief Checks if mapped data is a complete archive of supported version. */
+bool ArchiveValid(void) {
+	unsigned int i, names_size;
+	if ((archive_size < ARCHIVE_HEADER_SIZE) || (memcmp(archive_data, ARCHIVE_MAGIC, 4)) || (ReadLE32(archive_data + 4) != ARCHIVE_VERSION)) return false;
+	archive_count = ReadLE32(archive_data + 8);
+	names_size = ReadLE32(archive_data + 12);
+	if ((archive_count > archive_size / ARCHIVE_RECORD_SIZE) || (ARCHIVE_HEADER_SIZE + (size_t)archive_count * ARCHIVE_RECORD_SIZE + names_size > archive_size)) return false;
+	archive_names = (char*)archive_data + ARCHIVE_HEADER_SIZE + archive_count * ARCHIVE_RECORD_SIZE;
+	if ((!names_size) || (archive_names[names_size-1])) return false;
+	for (i=0; i<archive_count; i++) {
+		const unsigned char *record = archive_data + ARCHIVE_HEADER_SIZE + i * ARCHIVE_RECORD_SIZE;
+		if ((ReadLE32(record) >= names_size) || ((size_t)ReadLE32(record + 4) + ReadLE32(record + 8) > archive_size)) return false;
+		if ((i) && (strcmp(archive_names + ReadLE32(record - ARCHIVE_RECORD_SIZE), archive_names + ReadLE32(record)) >= 0)) return false;
+	}
+	return true;
+}
+
+/*! \brief Maps given file into memory. */
+bool MapArchive(char* filename) {
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER size;
+	if ((!GetFileSizeEx(file, &size)) || (!size.QuadPart)) {
+		CloseHandle(file);
+		return false;
+	}
+	archive_mapping = CreateFileMapping(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(file);
+	if (!archive_mapping) return false;
+	archive_data = MapViewOfFile(archive_mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!archive_data) {
+		CloseHandle(archive_mapping);
+		archive_mapping = NULL;
+		return false;
+	}
+	archive_size = size.QuadPart;
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if ((fstat(fd, &st)) || (!st.st_size)) {
+		close(fd);
+		return false;
+	}
+	void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+	archive_data = data;
+	archive_size = st.st_size;
+#endif
+	return true;
+}
+
+/*! \brief Unmaps archive file. */
+void UnmapArchive(void) {
+#ifdef _WIN32
+	UnmapViewOfFile(archive_data);
+	CloseHandle(archive_mapping);
+	archive_mapping = NULL;
+#else
+	munmap(archive_data, archive_size);
+#endif
+	archive_data = NULL;
+	archive_size = 0;
+	archive_count = 0;
+	archive_names = NULL;
+}
+
+bool Archive_Open(void) {
+	char *result = NULL;
+	void TestPath(char* subpath) {
+		if (result) return;
+		ALLEGRO_PATH *tail = al_create_path(ARCHIVE_FILENAME);
+		ALLEGRO_PATH *path = al_get_standard_path(ALLEGRO_RESOURCES_PATH);
+		ALLEGRO_PATH *data = al_create_path(subpath);
+		al_join_paths(path, data);
+		al_join_paths(path, tail);
+		if (al_filename_exists(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP))) {
+			result = strdup(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
+		}
+		al_destroy_path(tail);
+		al_destroy_path(data);
+		al_destroy_path(path);
+	}
+	if (archive_data) Archive_Close();
+	if (al_filename_exists(ARCHIVE_FILENAME)) result = strdup(ARCHIVE_FILENAME);
+	TestPath("../share/superderpy/");
+	TestPath("../");
+	TestPath("../Resources/");
+	TestPath("");
+	if (!result) return false;
+
+	if (!MapArchive(result)) {
+		fprintf(stderr, "Archive: failed to map %s!\n", result);
+		free(result);
+		return false;
+	}
+	if (!ArchiveValid()) {
+		fprintf(stderr, "Archive: %s is not a valid archive!\n", result);
+		UnmapArchive();
+		free(result);
+		return false;
+	}
+	free(result);
+	archive_fallback = al_get_new_file_interface();
+	Archive_UseFileInterface();
+	return true;
+}
+
+bool Archive_Contains(char* filename) {
+	return FindEntry(filename) != NULL;
+}
+
+void Archive_UseFileInterface(void) {
+	if (archive_data) al_set_new_file_interface(&archive_interface);
+}
+
+void Archive_Close(void) {
+	if (!archive_data) return;
+	al_set_new_file_interface(archive_fallback);
+	UnmapArchive();
+}
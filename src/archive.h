@@ -0,0 +1,36 @@
+/*! \file archive.h
+ *  \brief Memory-mapped data archive headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef ARCHIVE_H
+#define ARCHIVE_H
+
+#include "main.h"
+#include "archivefmt.h"
+
+/*! \brief Maps archive into memory. Returns false if there's no valid archive. */
+bool Archive_Open(void);
+/*! \brief Checks if archive contains given data file. */
+bool Archive_Contains(char* filename);
+/*! \brief Makes files in the archive available through al_fopen in calling thread. Must be called by every thread loading data. */
+void Archive_UseFileInterface(void);
+/*! \brief Unmaps archive. */
+void Archive_Close(void);
+
+#endif
@@ -0,0 +1,47 @@
+/*! \file archivefmt.h
+ *  \brief Archive file format definitions, shared by the game and the packing tool.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef ARCHIVEFMT_H
+#define ARCHIVEFMT_H
+
+/* no other headers here, so the packing tool builds without the game */
+
+/*! \brief Magic bytes at the beginning of archive file.
+ *
+ * Archive starts with a header (all numbers are 32-bit little endian), followed by index records
+ * sorted by name, table of NUL-terminated names relative to data directory, and entries,
+ * each aligned to ARCHIVE_ALIGN bytes.
+ */
+#define ARCHIVE_MAGIC "SDPK"
+/*! \brief Version of archive file format. */
+#define ARCHIVE_VERSION 1
+/*! \brief Alignment of entries inside archive, so each of them starts on its own page. */
+#define ARCHIVE_ALIGN 4096
+/*! \brief Size of archive header: magic, version, number of entries and size of name table. */
+#define ARCHIVE_HEADER_SIZE 16
+/*! \brief Size of one index record: offset of name, offset and size of data, reserved field. */
+#define ARCHIVE_RECORD_SIZE 16
+/*! \brief Prefix of paths pointing into the archive, as returned by GetDataFilePath. */
+#define ARCHIVE_PREFIX "sdpk:"
+
+/*! \brief Name of archive file, looked up next to data directory. */
+#define ARCHIVE_FILENAME "data.sdp"
+
+#endif
@@ -0,0 +1,141 @@
+/*! \file assets.c
+ *  \brief Refcounted asset cache with LRU eviction.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "config.h"
+#include "assets.h"
+
+/*! \brief Human readable names of asset types. */
+char* asset_type_names[] = { "bitmap", "sound", "font" };
+
+void Assets_Init(struct Game *game) {
+	game->assets.list = NULL;
+	game->assets.size = 0;
+	game->assets.clock = 0;
+	game->assets.budget = (size_t)GetConfigInt("SuperDerpy", "asset_budget", 256) * 1024 * 1024;
+}
+
+void* Assets_Get(struct Game *game, enum asset_type_enum type, char* key) {
+	struct Asset *tmp = game->assets.list;
+	while (tmp) {
+		if ((tmp->type == type) && (!strcmp(tmp->key, key))) {
+			tmp->refs++;
+			tmp->last_used = ++game->assets.clock;
+			return tmp->data;
+		}
+		tmp = tmp->next;
+	}
+	return NULL;
+}
+
+void Assets_Add(struct Game *game, enum asset_type_enum type, char* key, void* data, size_t size, void (*destroy)(void*)) {
+	struct Asset *asset = malloc(sizeof(struct Asset));
+	asset->type = type;
+	asset->key = strdup(key);
+	asset->data = data;
+	asset->size = size;
+	asset->refs = 1;
+	asset->last_used = ++game->assets.clock;
+	asset->destroy = destroy;
+	asset->next = game->assets.list;
+	game->assets.list = asset;
+	game->assets.size += size;
+	/* cached assets outlive the gamestate which loaded them */
+	Track_Retag(asset, "assets");
+	Track_Retag(asset->key, "assets");
+	Track_Retag(data, "assets");
+	PrintConsole(game, "Asset %s %s loaded (%zu kB, %zu kB total)", asset_type_names[type], key, size/1024, game->assets.size/1024);
+	Assets_Trim(game);
+}
+
+/*! \brief Unlinks and destroys asset pointed to by given link. */
+void AssetsDestroy(struct Game *game, struct Asset **link) {
+	struct Asset *asset = *link;
+	*link = asset->next;
+	game->assets.size -= asset->size;
+	asset->destroy(asset->data);
+	free(asset->key);
+	free(asset);
+}
+
+void Assets_Release(struct Game *game, void* data) {
+	struct Asset *tmp = game->assets.list;
+	while (tmp) {
+		if (tmp->data == data) {
+			if (tmp->refs > 0) tmp->refs--;
+			tmp->last_used = ++game->assets.clock;
+			Assets_Trim(game);
+			return;
+		}
+		tmp = tmp->next;
+	}
+	PrintConsole(game, "ERROR: Attempted to release unknown asset %p!", data);
+}
+
+void Assets_Trim(struct Game *game) {
+	while (game->assets.size > game->assets.budget) {
+		struct Asset **tmp = &game->assets.list, **lru = NULL;
+		while (*tmp) {
+			if ((!(*tmp)->refs) && ((!lru) || ((*tmp)->last_used < (*lru)->last_used))) lru = tmp;
+			tmp = &(*tmp)->next;
+		}
+		/* everything left is in use, so budget has to be exceeded for now */
+		if (!lru) return;
+		PrintConsole(game, "Asset %s %s evicted", asset_type_names[(*lru)->type], (*lru)->key);
+		AssetsDestroy(game, lru);
+	}
+}
+
+void Assets_Purge(struct Game *game, enum asset_type_enum type) {
+	struct Asset **tmp = &game->assets.list;
+	while (*tmp) {
+		if ((*tmp)->type != type) {
+			tmp = &(*tmp)->next;
+		} else if ((*tmp)->refs) {
+			/* someone still uses it, so it's leaked rather than left dangling */
+			PrintConsole(game, "ERROR: Asset %s %s still has %d refs, not purging!", asset_type_names[(*tmp)->type], (*tmp)->key, (*tmp)->refs);
+			tmp = &(*tmp)->next;
+		} else AssetsDestroy(game, tmp);
+	}
+}
+
+void Assets_Dump(struct Game *game) {
+	struct Asset *tmp = game->assets.list;
+	while (tmp) {
+		PrintConsole(game, "%s %s: %zu kB, %d refs", asset_type_names[tmp->type], tmp->key, tmp->size/1024, tmp->refs);
+		tmp = tmp->next;
+	}
+	PrintConsole(game, "Assets: %zu kB of %zu kB budget", game->assets.size/1024, game->assets.budget/1024);
+}
+
+/*! \brief Destroys bitmap asset. */
+void AssetsDestroyBitmap(void* data) {
+	al_destroy_bitmap(data);
+}
+
+ALLEGRO_BITMAP* Assets_LoadBitmap(struct Game *game, char* filename, int width, int height) {
+	char key[255];
+	snprintf(key, 255, "%s@%dx%d", filename, width, height);
+	ALLEGRO_BITMAP *bitmap = Assets_Get(game, ASSET_BITMAP, key);
+	if (bitmap) return bitmap;
+	bitmap = LoadScaledBitmap(filename, width, height);
+	Assets_Add(game, ASSET_BITMAP, key, bitmap, (size_t)width*height*4, &AssetsDestroyBitmap);
+	return bitmap;
+}
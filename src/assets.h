@@ -0,0 +1,65 @@
+/*! \file assets.h
+ *  \brief Refcounted asset cache with LRU eviction headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "main.h"
+
+/*! \brief Kinds of assets handled by asset manager. */
+enum asset_type_enum {
+	ASSET_BITMAP,
+	ASSET_SOUND,
+	ASSET_FONT
+};
+
+/*! \brief Asset shared between gamestates, identified by its type and key. */
+struct Asset {
+		enum asset_type_enum type; /*!< Kind of asset. */
+		char* key; /*!< Key identifying asset, e.g. file name with requested size. */
+		void* data; /*!< Loaded asset. */
+		size_t size; /*!< Estimated memory footprint, in bytes. */
+		int refs; /*!< Number of users. Asset may be evicted only when it drops to 0. */
+		unsigned long last_used; /*!< Value of asset clock when asset was last requested or released. */
+		void (*destroy)(void*); /*!< Function freeing the data. */
+		struct Asset *next; /*!< Pointer to next asset. */
+};
+
+/*! \brief Reads memory budget from configuration. */
+void Assets_Init(struct Game *game);
+/*! \brief Returns asset with given type and key, taking a reference to it, or NULL if it's not loaded. */
+void* Assets_Get(struct Game *game, enum asset_type_enum type, char* key);
+/*! \brief Registers freshly loaded asset with one reference taken by the caller. */
+void Assets_Add(struct Game *game, enum asset_type_enum type, char* key, void* data, size_t size, void (*destroy)(void*));
+/*! \brief Drops reference to asset. Unreferenced assets stay cached until budget is exceeded. */
+void Assets_Release(struct Game *game, void* data);
+/*! \brief Evicts least recently used unreferenced assets until total footprint fits in the budget. */
+void Assets_Trim(struct Game *game);
+/*! \brief Destroys every unreferenced asset of given type. Assets still referenced are reported and kept. */
+void Assets_Purge(struct Game *game, enum asset_type_enum type);
+/*! \brief Prints every loaded asset and total footprint on game console. */
+void Assets_Dump(struct Game *game);
+/*! \brief Returns bitmap from given data file scaled to given size, loading it only if it isn't cached.
+ *
+ * Bitmap is shared, so it must not be drawn on. Release it with Assets_Release.
+ */
+ALLEGRO_BITMAP* Assets_LoadBitmap(struct Game *game, char* filename, int width, int height);
+
+#endif
@@ -0,0 +1,118 @@
+/*! \file bake.c
+ *  \brief Offline asset baking.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "gamestates/level.h"
+#include "gamestates/pause.h"
+#include "texture.h"
+#include "bake.h"
+
+/*! \brief Data directory baked textures are written into, NULL when not baking. */
+char* bake_directory = NULL;
+/*! \brief Manifest of baked textures. */
+ALLEGRO_CONFIG *bake_manifest = NULL;
+/*! \brief Number of textures baked so far. */
+int bake_count = 0;
+
+bool Bake_Active(void) {
+	return bake_directory != NULL;
+}
+
+void Bake_Store(char* filename, int width, int height, ALLEGRO_BITMAP *bitmap) {
+	char key[255];
+	char* name = Texture_GetBakedFilename(filename, width, height);
+	ALLEGRO_PATH *path = al_create_path_for_directory(bake_directory);
+	ALLEGRO_PATH *tail = al_create_path(name);
+	al_join_paths(path, tail);
+	ALLEGRO_PATH *dir = al_clone_path(path);
+	al_set_path_filename(dir, NULL);
+	al_make_directory(al_path_cstr(dir, ALLEGRO_NATIVE_PATH_SEP));
+	if (al_save_bitmap(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP), bitmap)) {
+		snprintf(key, 255, "%s@%dx%d", filename, width, height);
+		al_set_config_value(bake_manifest, "textures", key, name);
+		bake_count++;
+	} else {
+		fprintf(stderr, "Bake: failed to save %s!\n", al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
+	}
+	al_destroy_path(dir);
+	al_destroy_path(tail);
+	al_destroy_path(path);
+	free(name);
+}
+
+int Bake_Run(struct Game *game, char* directory) {
+	int heights[] = BAKE_HEIGHTS;
+	char filename[255] = { }, list[255] = { };
+	unsigned int i;
+	int j;
+	bake_directory = directory;
+	bake_manifest = al_create_config();
+	game->gamestate = GAMESTATE_LOADING;
+
+	for (i=0; i<sizeof(heights)/sizeof(heights[0]); i++) {
+		game->viewportHeight = heights[i];
+		game->viewportWidth = heights[i] * 1920 / 1080;
+		printf("Bake: viewport %dx%d\n", game->viewportWidth, game->viewportHeight);
+		sprintf(list + strlen(list), "%s%d", i ? " " : "", heights[i]);
+
+		/* every state is preloaded and unloaded right away, so only one of them is in memory at once */
+		for (j=0; j<GAMESTATE_COUNT; j++) {
+			struct Gamestate *state = GetGameState(j);
+			if ((!state) || (!state->Preload) || (j == GAMESTATE_LEVEL)) continue;
+			state->Preload(game, NULL);
+			/* pause is preloaded by levels, on top of preloaded menu */
+			if (j == GAMESTATE_MENU) {
+				Pause_Preload(game);
+				Pause_Unload_Real(game);
+			}
+			state->Unload(game);
+		}
+		/* map preloads highlight of the last unlocked level only */
+		for (j=1; j<=6; j++) {
+			sprintf(filename, "map/highlight%d.png", j);
+			al_destroy_bitmap(LoadScaledBitmap(filename, game->viewportWidth, game->viewportHeight));
+		}
+		/* levels are baked without display, the same way they're simulated, so they don't load pause, fonts or music */
+		ALLEGRO_DISPLAY *display = game->display;
+		game->display = NULL;
+		for (j=1; j<=6; j++) {
+			memset(&game->level, 0, sizeof(game->level));
+			game->level.input.current_level = j;
+			Level_Preload(game, NULL);
+			Level_Unload(game);
+		}
+		game->display = display;
+	}
+
+	al_set_config_value(bake_manifest, "", "version", "1");
+	al_set_config_value(bake_manifest, "", "heights", list);
+	ALLEGRO_PATH *path = al_create_path_for_directory(directory);
+	ALLEGRO_PATH *tail = al_create_path(TEXTURE_MANIFEST);
+	al_join_paths(path, tail);
+	bool ok = al_save_config_file(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP), bake_manifest);
+	if (ok) printf("Bake: %d textures baked, manifest written to %s\n", bake_count, al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
+	else fprintf(stderr, "Bake: failed to write manifest %s!\n", al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
+	al_destroy_path(tail);
+	al_destroy_path(path);
+	al_destroy_config(bake_manifest);
+	bake_manifest = NULL;
+	bake_directory = NULL;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+/*! \file bake.h
+ *  \brief Offline asset baking headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef BAKE_H
+#define BAKE_H
+
+#include "main.h"
+
+/*! \brief Viewport heights bitmaps are baked for. Viewport width follows from 16:9 aspect ratio of letterboxed viewport. */
+#define BAKE_HEIGHTS { 720, 1080, 1440, 2160 }
+
+/*! \brief Checks if bitmaps are being baked right now. */
+bool Bake_Active(void);
+/*! \brief Saves bitmap scaled by LoadScaledBitmap as baked texture and adds it to the manifest. */
+void Bake_Store(char* filename, int width, int height, ALLEGRO_BITMAP *bitmap);
+/*! \brief Preloads every gamestate and level at every baked viewport size, writing scaled bitmaps and manifest into given data directory. */
+int Bake_Run(struct Game *game, char* directory);
+
+#endif
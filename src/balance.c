@@ -0,0 +1,280 @@
+/*! \file balance.c
+ *  \brief Headless balance simulator, running level with bot policies on many threads.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "gamestates/level.h"
+#include "balance.h"
+#include "archive.h"
+#include "pool.h"
+
+/*! \brief Simulated level run is cut off after that many ticks. */
+#define BALANCE_MAX_TICKS (15*60*LOGIC_FPS)
+/*! \brief HP distribution is printed every that many seconds. */
+#define BALANCE_REPORT_STEP 5
+
+/*! \brief Calculates Derpy's hitbox in pixels, the same way Dodger_Logic does. */
+void BotDerpyBox(struct Game *game, float *left, float *right, float *top, float *bottom) {
+	int derpyx = game->level.derpy_x*game->viewportWidth;
+	int derpyy = game->level.derpy_y*game->viewportHeight;
+	int derpyw = al_get_bitmap_width(game->level.derpy);
+	int derpyh = al_get_bitmap_height(game->level.derpy);
+	int derpyo = game->viewportWidth*0.1953125-al_get_bitmap_width(game->level.derpy); /* offset */
+	*left = derpyx+0.38*derpyw+derpyo;
+	*right = derpyx+0.94*derpyw+derpyo;
+	*top = derpyy+0.26*derpyh;
+	*bottom = derpyy+0.76*derpyh;
+}
+
+/*! \brief Calculates obstacle's bounding box in pixels. Returns false if obstacle can't be hit anymore. */
+bool BotObstacleBox(struct Game *game, struct Obstacle *obstacle, float *x, float *y, float *w, float *h) {
+	if ((!obstacle->bitmap) || (obstacle->hit)) return false;
+	*x = (int)((obstacle->x/100.0)*game->viewportWidth);
+	*y = (int)((obstacle->y/100.0)*game->viewportHeight);
+	*w = al_get_bitmap_width(*(obstacle->bitmap))/obstacle->cols;
+	*h = al_get_bitmap_height(*(obstacle->bitmap))/obstacle->rows;
+	return true;
+}
+
+/*! \brief Just holds Enter to get through the letter, never steers. */
+unsigned char BotIdle(struct Game *game) {
+	return INPUT_ENTER;
+}
+
+/*! \brief Flies away from the closest harmful obstacle on Derpy's course. */
+unsigned char BotDodgeNearest(struct Game *game) {
+	if (!game->level.derpy) return INPUT_ENTER;
+	float left, right, top, bottom, x, y, w, h;
+	BotDerpyBox(game, &left, &right, &top, &bottom);
+	float margin = (bottom-top)*0.5, distance = game->viewportWidth*0.5, center = 0;
+	struct Obstacle *tmp = game->level.dodger.obstacles;
+	bool found = false;
+	while (tmp) {
+		if ((tmp->points<0) && (BotObstacleBox(game, tmp, &x, &y, &w, &h)) && (x+w >= left) && (y+h >= top-margin) && (y <= bottom+margin)) {
+			float d = x > right ? x - right : 0;
+			if (d < distance) {
+				distance = d;
+				center = y+h/2;
+				found = true;
+			}
+		}
+		tmp = tmp->next;
+	}
+	if (!found) return INPUT_ENTER;
+	bool down = center < (top+bottom)/2;
+	if ((down) && (game->level.derpy_y >= 0.79)) down = false;
+	else if ((!down) && (game->level.derpy_y <= 0.01)) down = true;
+	return INPUT_ENTER | (down ? INPUT_DOWN : INPUT_UP);
+}
+
+/*! \brief Chases the closest collectible obstacle, ignoring any danger. */
+unsigned char BotGreedyMuffin(struct Game *game) {
+	if (!game->level.derpy) return INPUT_ENTER;
+	float left, right, top, bottom, x, y, w, h;
+	BotDerpyBox(game, &left, &right, &top, &bottom);
+	float distance = game->viewportWidth, center = 0;
+	struct Obstacle *tmp = game->level.dodger.obstacles;
+	bool found = false;
+	while (tmp) {
+		if ((tmp->points>0) && (BotObstacleBox(game, tmp, &x, &y, &w, &h)) && (x+w >= left) && (x - left < distance)) {
+			distance = x - left;
+			center = y+h/2;
+			found = true;
+		}
+		tmp = tmp->next;
+	}
+	if (!found) return INPUT_ENTER;
+	float deadzone = (bottom-top)*0.1;
+	if (center < (top+bottom)/2 - deadzone) return INPUT_ENTER | INPUT_UP;
+	if (center > (top+bottom)/2 + deadzone) return INPUT_ENTER | INPUT_DOWN;
+	return INPUT_ENTER;
+}
+
+/*! \brief Available bot policies. */
+struct BalancePolicy policies[] = {
+	{ "dodge-nearest", &BotDodgeNearest },
+	{ "greedy-muffin", &BotGreedyMuffin },
+	{ "idle", &BotIdle }
+};
+
+/*! \brief Number of available bot policies. */
+#define BALANCE_POLICIES (int)(sizeof(policies)/sizeof(policies[0]))
+
+/*! \brief Returns number of available CPU cores. */
+int BalanceCPUCount(void) {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return count > 0 ? count : 1;
+#endif
+}
+
+/*! \brief Simulates single level run on the calling thread. */
+void BalanceSimulate(struct Game *game, struct BalanceWorker *worker, struct BalanceJob *job) {
+	game->level.input.current_level = worker->shared->level;
+	game->level.input.seed = job->seed;
+	game->level.input.bot = policies[job->policy].bot;
+	Level_Preload(game, NULL);
+	Level_Load(game);
+	job->hp = malloc(sizeof(float)*(BALANCE_MAX_TICKS/LOGIC_FPS));
+	double start = al_get_time();
+	while (!game->level.unloading) {
+		Level_Logic(game);
+		job->ticks++;
+		if (!(job->ticks % LOGIC_FPS)) job->hp[job->samples++] = game->level.hp;
+		if ((!game->level.unloading) && (job->ticks >= BALANCE_MAX_TICKS)) Level_Unload(game);
+	}
+	worker->time += al_get_time() - start;
+	worker->ticks += job->ticks;
+	job->failed = game->level.failed;
+}
+
+/*! \brief Simulation thread - keeps picking level runs until there are none left. */
+void* BalanceThread(ALLEGRO_THREAD *thread, void *arg) {
+	struct BalanceWorker *worker = arg;
+	struct BalanceShared *shared = worker->shared;
+	/* every thread has its own Game, timeline, bitmap flags and file interface */
+	struct Game *game = calloc(1, sizeof(struct Game));
+	Archive_UseFileInterface();
+	game->display = NULL;
+	game->replay = NULL;
+	game->debug = false;
+	game->viewportWidth = shared->viewportWidth;
+	game->viewportHeight = shared->viewportHeight;
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+	while (true) {
+		al_lock_mutex(shared->mutex);
+		int i = shared->next++;
+		al_unlock_mutex(shared->mutex);
+		if (i >= shared->count) break;
+		BalanceSimulate(game, worker, &shared->jobs[i]);
+	}
+	FreeDerpySpritesheets(game);
+	Pool_Destroy(game);
+	free(game);
+	return NULL;
+}
+
+/*! \brief Comparison function for qsort. */
+int BalanceCompare(const void *a, const void *b) {
+	float x = *(const float*)a, y = *(const float*)b;
+	return (x > y) - (x < y);
+}
+
+int Balance_Run(struct Game *game, int runs, int threads, int level, unsigned int seed) {
+	if (runs <= 0) {
+		fprintf(stderr, "number of runs must be positive!\n");
+		return -1;
+	}
+	if (threads <= 0) threads = BalanceCPUCount();
+	if (!level) level = 1;
+
+	struct BalanceShared shared;
+	shared.count = runs*BALANCE_POLICIES;
+	shared.jobs = calloc(shared.count, sizeof(struct BalanceJob));
+	shared.next = 0;
+	shared.mutex = al_create_mutex();
+	shared.level = level;
+	/* viewport of configured window size, letterboxed as by SetupViewport */
+	shared.viewportWidth = game->width;
+	shared.viewportHeight = game->width / ((float)1920 / (float)1080);
+	if (shared.viewportHeight > game->height) {
+		shared.viewportHeight = game->height;
+		shared.viewportWidth = game->height * ((float)1920 / (float)1080);
+	}
+	int i, j;
+	/* every policy plays the same seeds, so they can be compared run by run */
+	for (i=0; i<shared.count; i++) {
+		shared.jobs[i].policy = i % BALANCE_POLICIES;
+		shared.jobs[i].seed = seed + i / BALANCE_POLICIES;
+		if (!shared.jobs[i].seed) shared.jobs[i].seed = 1;
+	}
+
+	printf("Balance: level %d, %d runs per policy, seeds %u-%u, viewport %dx%d, %d threads\n", level, runs, seed, seed+runs-1, shared.viewportWidth, shared.viewportHeight, threads);
+	double start = al_get_time();
+	struct BalanceWorker *workers = calloc(threads, sizeof(struct BalanceWorker));
+	for (i=0; i<threads; i++) {
+		workers[i].shared = &shared;
+		workers[i].thread = al_create_thread(&BalanceThread, &workers[i]);
+		al_start_thread(workers[i].thread);
+	}
+	unsigned long long ticks = 0;
+	double time = 0;
+	for (i=0; i<threads; i++) {
+		al_join_thread(workers[i].thread, NULL);
+		al_destroy_thread(workers[i].thread);
+		ticks += workers[i].ticks;
+		time += workers[i].time;
+	}
+	double wall = al_get_time() - start;
+
+	printf("\n%-16s %8s %8s %8s %12s\n", "policy", "runs", "failed", "fail%", "avg ticks");
+	int longest = 0;
+	for (j=0; j<BALANCE_POLICIES; j++) {
+		int failed = 0;
+		unsigned long long total = 0;
+		for (i=j; i<shared.count; i+=BALANCE_POLICIES) {
+			if (shared.jobs[i].failed) failed++;
+			total += shared.jobs[i].ticks;
+			if (shared.jobs[i].samples > longest) longest = shared.jobs[i].samples;
+		}
+		printf("%-16s %8d %8d %7.1f%% %12.0f\n", policies[j].name, runs, failed, 100.0*failed/runs, (double)total/runs);
+	}
+
+	printf("\nHP over time, p10/p50/p90 of runs still in progress:\n%6s", "t[s]");
+	for (j=0; j<BALANCE_POLICIES; j++) printf(" %20s", policies[j].name);
+	printf("\n");
+	float *values = malloc(sizeof(float)*runs);
+	int t;
+	for (t=BALANCE_REPORT_STEP; t<=longest; t+=BALANCE_REPORT_STEP) {
+		printf("%6d", t);
+		for (j=0; j<BALANCE_POLICIES; j++) {
+			int count = 0;
+			for (i=j; i<shared.count; i+=BALANCE_POLICIES) {
+				if (shared.jobs[i].samples >= t) values[count++] = shared.jobs[i].hp[t-1];
+			}
+			if (!count) {
+				printf(" %20s", "-");
+				continue;
+			}
+			qsort(values, count, sizeof(float), &BalanceCompare);
+			char cell[32];
+			snprintf(cell, 32, "%.2f/%.2f/%.2f", values[count/10], values[count/2], values[count*9/10]);
+			printf(" %20s", cell);
+		}
+		printf("\n");
+	}
+	free(values);
+
+	printf("\nThroughput: %llu ticks in %.3f s, %.0f ticks/s per core, %.0f ticks/s total\n", ticks, wall, time > 0 ? ticks/time : 0, wall > 0 ? ticks/wall : 0);
+
+	for (i=0; i<shared.count; i++) free(shared.jobs[i].hp);
+	free(shared.jobs);
+	free(workers);
+	al_destroy_mutex(shared.mutex);
+	return 0;
+}
@@ -0,0 +1,64 @@
+/*! \file balance.h
+ *  \brief Headless balance simulator headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef BALANCE_H
+#define BALANCE_H
+
+#include "main.h"
+
+/*! \brief Scripted player policy used to play simulated level runs. */
+struct BalancePolicy {
+		char* name; /*!< Name of the policy, used in report. */
+		unsigned char (*bot)(struct Game*); /*!< Function returning input bits for current logic tick. */
+};
+
+/*! \brief Single simulated level run. */
+struct BalanceJob {
+		int policy; /*!< Index of used policy. */
+		unsigned int seed; /*!< Seed of the level run. */
+		bool failed; /*!< True if Derpy ran out of power. */
+		unsigned int ticks; /*!< Number of logic ticks until level was unloaded. */
+		float *hp; /*!< HP sampled at the end of every second of the run. */
+		int samples; /*!< Number of HP samples. */
+};
+
+/*! \brief State shared by all simulation threads. */
+struct BalanceShared {
+		struct BalanceJob *jobs; /*!< List of all level runs. */
+		int count; /*!< Number of level runs. */
+		int next; /*!< Index of next level run to be picked by a thread. */
+		ALLEGRO_MUTEX *mutex; /*!< Mutex guarding next. */
+		int level; /*!< Simulated level. */
+		int viewportWidth; /*!< Viewport width used in simulation. */
+		int viewportHeight; /*!< Viewport height used in simulation. */
+};
+
+/*! \brief Simulation thread. */
+struct BalanceWorker {
+		ALLEGRO_THREAD *thread; /*!< Thread handle. */
+		struct BalanceShared *shared; /*!< Shared state. */
+		unsigned long long ticks; /*!< Number of logic ticks simulated by this thread. */
+		double time; /*!< Time spent by this thread in simulation, preloading excluded. */
+};
+
+/*! \brief Simulates given number of runs of level for every bot policy on all cores and prints report. */
+int Balance_Run(struct Game *game, int runs, int threads, int level, unsigned int seed);
+
+#endif
@@ -18,11 +18,77 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 #include <allegro5/allegro.h>
 #include "config.h"
 
 ALLEGRO_CONFIG *config;
 
+/* config is changed only by the main thread, but typed entries can be parsed and saving is done in other ones */
+ALLEGRO_MUTEX *config_mutex;
+ALLEGRO_COND *config_cond;
+ALLEGRO_THREAD *config_thread;
+struct ConfigInt *config_ints;
+bool config_dirty;
+double config_deadline;
+
+/*! \brief Writes given config to temporary file and moves it over the real one, so the file is never left half written. */
+bool SaveConfigFile(ALLEGRO_CONFIG *cfg) {
+	ALLEGRO_PATH *path = al_get_standard_path(ALLEGRO_USER_SETTINGS_PATH);
+	ALLEGRO_PATH *data = al_create_path("SuperDerpy.ini");
+	al_make_directory(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
+	al_join_paths(path, data);
+	const char* filename = al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP);
+	char tmp[4096];
+	snprintf(tmp, sizeof(tmp), "%s.tmp", filename);
+	bool ok = al_save_config_file(tmp, cfg);
+	if (ok) {
+#ifdef _WIN32
+		ok = MoveFileEx(tmp, filename, MOVEFILE_REPLACE_EXISTING);
+#else
+		ok = !rename(tmp, filename);
+#endif
+	}
+	if (!ok) fprintf(stderr, "failed to save config file %s!\n", filename);
+	al_destroy_path(path);
+	al_destroy_path(data);
+	return ok;
+}
+
+/*! \brief Saves config once changes settle, until asked to stop. */
+void* ConfigThread(ALLEGRO_THREAD *thread, void *arg) {
+	al_lock_mutex(config_mutex);
+	while (true) {
+		if (!config_dirty) {
+			if (al_get_thread_should_stop(thread)) break;
+			al_wait_cond(config_cond, config_mutex);
+			continue;
+		}
+		double now = al_get_time();
+		if ((now < config_deadline) && (!al_get_thread_should_stop(thread))) {
+			ALLEGRO_TIMEOUT timeout;
+			al_init_timeout(&timeout, config_deadline - now);
+			al_wait_cond_until(config_cond, config_mutex, &timeout);
+			continue;
+		}
+		/* file is written from a copy, so config can be changed meanwhile */
+		ALLEGRO_CONFIG *copy = al_create_config();
+		al_merge_config_into(copy, config);
+		config_dirty = false;
+		al_unlock_mutex(config_mutex);
+		SaveConfigFile(copy);
+		al_destroy_config(copy);
+		al_lock_mutex(config_mutex);
+	}
+	al_unlock_mutex(config_mutex);
+	return NULL;
+}
+
 void InitConfig(void) {
 	ALLEGRO_PATH *path = al_get_standard_path(ALLEGRO_USER_SETTINGS_PATH);
 	ALLEGRO_PATH *data = al_create_path("SuperDerpy.ini");
@@ -31,10 +97,57 @@ void InitConfig(void) {
 	if (!config) config=al_create_config();
 	al_destroy_path(path);
 	al_destroy_path(data);
+	config_mutex = al_create_mutex();
+	config_cond = al_create_cond();
+	config_thread = NULL;
+	config_ints = NULL;
+	config_dirty = false;
+}
+
+/*! \brief Returns typed entry with given section and name, parsing it if it's requested for the first time. Needs mutex to be locked. */
+struct ConfigInt* FindConfigInt(char* section, char* name, int def) {
+	struct ConfigInt *option = config_ints;
+	while (option) {
+		if ((!strcmp(option->name, name)) && (!strcmp(option->section, section))) return option;
+		option = option->next;
+	}
+	option = malloc(sizeof(struct ConfigInt));
+	option->section = strdup(section);
+	option->name = strdup(name);
+	const char* value = al_get_config_value(config, section, name);
+	option->value = value ? atoi(value) : def;
+	option->callback = NULL;
+	option->data = NULL;
+	option->next = config_ints;
+	config_ints = option;
+	return option;
 }
 
 void SetConfigOption(char* section, char* name, char* value) {
+	al_lock_mutex(config_mutex);
 	al_set_config_value(config, section, name, value);
+	void (*callback)(int, void*) = NULL;
+	void* data = NULL;
+	int parsed = 0;
+	struct ConfigInt *option = config_ints;
+	while (option) {
+		if ((!strcmp(option->name, name)) && (!strcmp(option->section, section))) {
+			option->value = parsed = atoi(value);
+			callback = option->callback;
+			data = option->data;
+			break;
+		}
+		option = option->next;
+	}
+	config_dirty = true;
+	config_deadline = al_get_time() + CONFIG_SAVE_DELAY;
+	if (!config_thread) {
+		config_thread = al_create_thread(ConfigThread, NULL);
+		if (config_thread) al_start_thread(config_thread);
+	}
+	al_broadcast_cond(config_cond);
+	al_unlock_mutex(config_mutex);
+	if (callback) (*callback)(parsed, data);
 }
 
 const char* GetConfigOption(char* section, char* name) {
@@ -46,13 +159,49 @@ const char* GetConfigOptionDefault(char* section, char* name, const char* def) {
 	if (!ret) return def; else return ret;
 }
 
+int GetConfigInt(char* section, char* name, int def) {
+	al_lock_mutex(config_mutex);
+	int value = FindConfigInt(section, name, def)->value;
+	al_unlock_mutex(config_mutex);
+	return value;
+}
+
+void SetConfigInt(char* section, char* name, int value) {
+	char text[16];
+	snprintf(text, sizeof(text), "%d", value);
+	SetConfigOption(section, name, text);
+}
+
+int WatchConfigInt(char* section, char* name, int def, void (*callback)(int, void*), void* data) {
+	al_lock_mutex(config_mutex);
+	struct ConfigInt *option = FindConfigInt(section, name, def);
+	option->callback = callback;
+	option->data = data;
+	int value = option->value;
+	al_unlock_mutex(config_mutex);
+	return value;
+}
+
 void DeinitConfig(void) {
-	ALLEGRO_PATH *path = al_get_standard_path(ALLEGRO_USER_SETTINGS_PATH);
-	ALLEGRO_PATH *data = al_create_path("SuperDerpy.ini");
-	al_make_directory(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
-	al_join_paths(path, data);
-	al_save_config_file(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP), config);
-	al_destroy_path(path);
-	al_destroy_path(data);
+	if (config_thread) {
+		/* thread saves pending changes right away when it's asked to stop */
+		al_lock_mutex(config_mutex);
+		al_set_thread_should_stop(config_thread);
+		al_broadcast_cond(config_cond);
+		al_unlock_mutex(config_mutex);
+		al_join_thread(config_thread, NULL);
+		al_destroy_thread(config_thread);
+		config_thread = NULL;
+	}
+	if (config_dirty) SaveConfigFile(config);
+	while (config_ints) {
+		struct ConfigInt *option = config_ints;
+		config_ints = option->next;
+		free(option->section);
+		free(option->name);
+		free(option);
+	}
+	al_destroy_cond(config_cond);
+	al_destroy_mutex(config_mutex);
 	al_destroy_config(config);
 }
@@ -18,13 +18,40 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
+#include <stdbool.h>
+
+/*! \brief Time from the last change to saving config file, in seconds, so bursts of changes are written once. */
+#define CONFIG_SAVE_DELAY 1.0
+
+/*! \brief Integer config entry, parsed once and kept in sync with the entry by SetConfigOption. */
+struct ConfigInt {
+		char* section; /*!< Section of the entry. */
+		char* name; /*!< Name of the entry. */
+		int value; /*!< Parsed value of the entry. */
+		void (*callback)(int, void*); /*!< Function called with new value whenever it's changed, or NULL. */
+		void* data; /*!< Data passed to the callback. */
+		struct ConfigInt *next; /*!< Pointer to next entry. */
+};
+
 /*! \brief Reads config from file into memory. */
 void InitConfig(void);
 /*! \brief Returns value of requested config entry. */
 const char* GetConfigOption(char* section, char* name);
 /*! \brief Returns value of requested config entry, or def if no such entry exists. */
 const char* GetConfigOptionDefault(char* section, char* name, const char* def);
-/*! \brief Sets new value of requested config entry, or created new if no such entry exists. */
+/*! \brief Sets new value of requested config entry, or created new if no such entry exists.
+ *
+ * Config file is saved in background once changes settle for CONFIG_SAVE_DELAY.
+ */
 void SetConfigOption(char* section, char* name, char* value);
-/*! \brief Writes config from memory to file. */
+/*! \brief Returns integer value of requested config entry, or def if no such entry exists.
+ *
+ * Entry is parsed on first request only, later ones return cached value, together with default given back then.
+ */
+int GetConfigInt(char* section, char* name, int def);
+/*! \brief Sets integer value of requested config entry. */
+void SetConfigInt(char* section, char* name, int value);
+/*! \brief Sets function called with new value of requested integer entry whenever it's changed. Returns current value. */
+int WatchConfigInt(char* section, char* name, int def, void (*callback)(int, void*), void* data);
+/*! \brief Writes pending changes to file and frees config. */
 void DeinitConfig(void);
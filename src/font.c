@@ -0,0 +1,70 @@
+/*! \file font.c
+ *  \brief Cache of TrueType fonts with prerendered glyphs, kept by asset manager.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "assets.h"
+#include "font.h"
+
+/*! \brief Characters which glyphs are rendered into font cache right after loading. */
+#define FONT_PRELOAD_GLYPHS " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
+
+/*! \brief Destroys font asset. */
+void FontDestroy(void* data) {
+	al_destroy_font(data);
+}
+
+ALLEGRO_FONT* Font_Load(struct Game *game, char* filename, int size) {
+	char key[255];
+	snprintf(key, 255, "%s@%d", filename, size);
+	/* font cache keeps single reference to every font until Font_UnloadAll, so fonts are never evicted */
+	ALLEGRO_FONT *font = Assets_Get(game, ASSET_FONT, key);
+	if (font) {
+		Assets_Release(game, font);
+		return font;
+	}
+	char* path = GetDataFilePath(filename);
+	font = al_load_ttf_font(path, size, 0);
+	free(path);
+	if (!font) return NULL;
+
+	/* glyphs are rasterised lazily on first draw, so do it now for everything
+	   the game prints, packing them together into font's glyph pages */
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
+	ALLEGRO_BITMAP *scratch = al_create_bitmap(1, 1);
+	al_set_target_bitmap(scratch);
+	al_draw_text(font, al_map_rgb(0,0,0), 0, 0, ALLEGRO_ALIGN_LEFT, FONT_PRELOAD_GLYPHS);
+	al_set_target_bitmap(target);
+	al_destroy_bitmap(scratch);
+
+	/* fonts can't be evicted, so they're kept outside of the budget */
+	Assets_Add(game, ASSET_FONT, key, font, 0, &FontDestroy);
+	return font;
+}
+
+void Font_UnloadAll(struct Game *game) {
+	/* releasing may evict assets, so the list is searched again after every font */
+	while (true) {
+		struct Asset *tmp = game->assets.list;
+		while ((tmp) && ((tmp->type != ASSET_FONT) || (!tmp->refs))) tmp = tmp->next;
+		if (!tmp) break;
+		Assets_Release(game, tmp->data);
+	}
+	Assets_Purge(game, ASSET_FONT);
+}
@@ -0,0 +1,34 @@
+/*! \file font.h
+ *  \brief Cache of TrueType fonts with prerendered glyphs headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef FONT_H
+#define FONT_H
+
+#include "main.h"
+
+/*! \brief Returns font from given data file at given pixel size, loading it and prerendering its glyphs only on first use.
+ *
+ * Fonts are kept by asset manager for the whole session and must not be destroyed by the caller.
+ */
+ALLEGRO_FONT* Font_Load(struct Game *game, char* filename, int size);
+/*! \brief Destroys all cached fonts, e.g. when viewport size has changed. */
+void Font_UnloadAll(struct Game *game);
+
+#endif
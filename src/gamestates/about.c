@@ -19,15 +19,69 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 #include <stdio.h>
+#include "../font.h"
+#include "../assets.h"
+#include "../pool.h"
 #include "about.h"
 
+/*! \brief Position in music, in seconds, at which credits start to show up. */
+#define ABOUT_CREDITS_START 15.873
+/*! \brief Position in music, in seconds, at which playback starts if music is audible. */
+#define ABOUT_MUSIC_START 9.524
+
+/*! \brief Rasterises given part of credits into its slot in the ring, unless it's already there. */
+ALLEGRO_BITMAP* GetStrip(struct Game *game, int index) {
+	int slot = index % ABOUT_STRIPS;
+	ALLEGRO_BITMAP *strip = game->about.strips[slot];
+	if (game->about.strip_index[slot] == index) return strip;
+	game->about.strip_index[slot] = index;
+
+	int top = index * game->about.strip_height, line_height = al_get_font_line_height(game->about.font);
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
+	al_set_target_bitmap(strip);
+	al_clear_to_color(al_map_rgba(0,0,0,0));
+	al_hold_bitmap_drawing(true);
+	int i;
+	for (i=0; i<game->about.line_count; i++) {
+		struct AboutLine *line = &game->about.lines[i];
+		if ((line->y + line_height <= top) || (line->y >= top + game->about.strip_height)) continue;
+		al_draw_text(game->about.font, al_map_rgb(0,0,0), line->x, line->y - top, line->align, line->text);
+	}
+	al_hold_bitmap_drawing(false);
+	al_set_target_bitmap(target);
+	return strip;
+}
+
+/*! \brief Draws one screen of credits starting at given position, rotated to lie on the letter. */
+void DrawCredits(struct Game *game, float x) {
+	int top = x * game->about.text_height, height = game->viewportHeight, width = game->about.text_width;
+	int first = top / game->about.strip_height, last = (top + height - 1) / game->about.strip_height, i;
+	/* strips are refilled before the transform is changed, as that switches target bitmaps */
+	for (i=first; i<=last; i++) {
+		GetStrip(game, i);
+	}
+
+	ALLEGRO_TRANSFORM old, transform;
+	al_copy_transform(&old, al_get_current_transform());
+	al_build_transform(&transform, game->viewportWidth*0.5 + width/2.0, game->viewportHeight*0.1 + height/2.0, 1, 1, -0.11);
+	al_compose_transform(&transform, &old);
+	al_use_transform(&transform);
+	for (i=first; i<=last; i++) {
+		int from = i * game->about.strip_height, to = from + game->about.strip_height;
+		if (from < top) from = top;
+		if (to > top + height) to = top + height;
+		al_draw_bitmap_region(GetStrip(game, i), 0, from - i * game->about.strip_height, width, to - from, -width/2.0, from - top - height/2.0, 0);
+	}
+	al_use_transform(&old);
+}
+
 void About_Logic(struct Game *game) {
-	if (al_get_sample_instance_position(game->about.music)<700000) { return; }
+	if (al_get_audio_stream_position_secs(game->about.music)<ABOUT_CREDITS_START) { return; }
 	if (game->about.fadeloop>=0) {
 		if (game->about.fadeloop==0) PrintConsole(game, "Fade in");
 		game->about.fadeloop+=5;
 		if (game->about.fadeloop>=256) {
-			al_destroy_bitmap(game->about.fade_bitmap);
+			Pool_Release(game, game->about.fade_bitmap);
 			game->about.fadeloop=-1;
 		}
 		return;
@@ -36,8 +90,8 @@ void About_Logic(struct Game *game) {
 }
 
 void About_Draw(struct Game *game) {
-	/*PrintConsole(game, "%d", al_get_sample_instance_position(game->about.music));*/
-	if (al_get_sample_instance_position(game->about.music)<700000) { al_clear_to_color(al_map_rgba(0,0,0,0)); return; }
+	/*PrintConsole(game, "%f", al_get_audio_stream_position_secs(game->about.music));*/
+	if (al_get_audio_stream_position_secs(game->about.music)<ABOUT_CREDITS_START) { al_clear_to_color(al_map_rgba(0,0,0,0)); return; }
 	if (game->about.fadeloop>=0) {
 		if (game->about.fadeloop==0) PrintConsole(game, "Fade in");
 		al_draw_tinted_bitmap(game->about.fade_bitmap,al_map_rgba_f(game->about.fadeloop/255.0,game->about.fadeloop/255.0,game->about.fadeloop/255.0,1),0,0,0);
@@ -48,10 +102,7 @@ void About_Draw(struct Game *game) {
 	al_draw_bitmap(game->about.letter, game->viewportWidth*0.3, -game->viewportHeight*0.1, 0);
 	float x = game->about.x;
 	if (x<0) x=0;
-	ALLEGRO_BITMAP* subbitmap;
-	subbitmap = al_create_sub_bitmap(game->about.text_bitmap, 0, x*al_get_bitmap_height(game->about.text_bitmap), al_get_bitmap_width(game->about.text_bitmap), game->viewportHeight);
-	al_draw_rotated_bitmap(subbitmap, al_get_bitmap_width(subbitmap)/2.0, al_get_bitmap_height(subbitmap)/2.0, game->viewportWidth*0.5+al_get_bitmap_width(subbitmap)/2.0, game->viewportHeight*0.1+al_get_bitmap_height(subbitmap)/2.0, -0.11, 0);
-	al_destroy_bitmap(subbitmap);
+	DrawCredits(game, x);
 	if ((game->about.x>1) && (game->about.x<10)) {
 		game->about.x=10;
 		UnloadGameState(game);
@@ -61,7 +112,7 @@ void About_Draw(struct Game *game) {
 }
 
 void About_Load(struct Game *game) {
-	al_play_sample_instance(game->about.music);
+	al_set_audio_stream_playing(game->about.music, true);
 	game->about.fadeloop = 0;
 	About_Draw(game);
 }
@@ -78,35 +129,38 @@ int About_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 void About_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	PROGRESS_INIT(6);
 
-	game->about.image =LoadScaledBitmap("table.png", game->viewportWidth, game->viewportHeight);
+	game->about.image = Assets_LoadBitmap(game, "table.png", game->viewportWidth, game->viewportHeight);
 	PROGRESS;
-	game->about.letter = LoadScaledBitmap("about/letter.png", game->viewportHeight*1.3, game->viewportHeight*1.3 );
+	game->about.letter = Assets_LoadBitmap(game, "about/letter.png", game->viewportHeight*1.3, game->viewportHeight*1.3);
 	PROGRESS;
 
-	game->about.sample = al_load_sample( GetDataFilePath("about/about.flac") );
+	game->about.music = LoadMusic(game, "about/about.flac");
+	al_seek_audio_stream_secs(game->about.music, game->music ? ABOUT_MUSIC_START : ABOUT_CREDITS_START);
 	PROGRESS;
 
-	game->about.music = al_create_sample_instance(game->about.sample);
-	al_attach_sample_instance_to_mixer(game->about.music, game->audio.music);
-	al_set_sample_instance_playmode(game->about.music, ALLEGRO_PLAYMODE_LOOP);
-	al_set_sample_instance_position(game->about.music, game->music ? 420000 : 700000);
-
-	game->about.font = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.035,0 );
+	game->about.font = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.035);
 	PROGRESS;
 	game->about.x = -0.1;
-	if (!game->about.sample){
-		fprintf(stderr, "Audio clip sample not loaded!\n" );
-		exit(-1);
+	game->about.text_width = game->viewportWidth*0.4;
+	game->about.text_height = game->viewportHeight*3.225;
+	game->about.lines = NULL;
+	game->about.line_count = 0;
+
+	/* credits are only laid out here, strips of them are rasterised while they scroll by */
+	void add_line(float x, float y, int align, char* text) {
+		game->about.lines = realloc(game->about.lines, (game->about.line_count+1)*sizeof(struct AboutLine));
+		struct AboutLine *line = &game->about.lines[game->about.line_count++];
+		line->text = text;
+		line->x = x*game->about.text_width;
+		line->y = y*game->about.text_height;
+		line->align = align;
 	}
-	game->about.text_bitmap = al_create_bitmap(game->viewportWidth*0.4, game->viewportHeight*3.225);
-	al_set_target_bitmap(game->about.text_bitmap);
-	al_clear_to_color(al_map_rgba(0,0,0,0));
-	al_draw_text(game->about.font, al_map_rgb(0,0,0), 0.5*al_get_bitmap_width(game->about.text_bitmap), 0.015*al_get_bitmap_height(game->about.text_bitmap), ALLEGRO_ALIGN_CENTRE, "Super Derpy: Muffin Attack");
-	al_draw_text(game->about.font, al_map_rgb(0,0,0), 0.5*al_get_bitmap_width(game->about.text_bitmap), 0.035*al_get_bitmap_height(game->about.text_bitmap), ALLEGRO_ALIGN_CENTRE, "Version 0.1a (Development Preview)");
-	
+	add_line(0.5, 0.015, ALLEGRO_ALIGN_CENTRE, "Super Derpy: Muffin Attack");
+	add_line(0.5, 0.035, ALLEGRO_ALIGN_CENTRE, "Version 0.1a (Development Preview)");
+
 	float y=0.07;
 	void draw_text(char* text) {
-		al_draw_text(game->about.font, al_map_rgb(0,0,0), 0, y*al_get_bitmap_height(game->about.text_bitmap), ALLEGRO_ALIGN_LEFT, text);
+		add_line(0, y, ALLEGRO_ALIGN_LEFT, text);
 		y+=0.0131;
 	}
 
@@ -190,17 +244,23 @@ void About_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	draw_text("or its associates.");
 	draw_text("");
 	draw_text("http://www.superderpy.com/");
+
+	/* ring has to cover the whole screen at any scroll position */
+	game->about.strip_height = (game->viewportHeight + ABOUT_STRIPS - 2) / (ABOUT_STRIPS - 1);
+	int i;
+	for (i=0; i<ABOUT_STRIPS; i++) {
+		game->about.strips[i] = al_create_bitmap(game->about.text_width, game->about.strip_height);
+		game->about.strip_index[i] = -1;
+	}
 	PROGRESS;
 
-	game->about.fade_bitmap = al_create_bitmap(game->viewportWidth, game->viewportHeight);
+	game->about.fade_bitmap = Pool_Acquire(game, game->viewportWidth, game->viewportHeight);
 
 	al_set_target_bitmap(game->about.fade_bitmap);
+	al_clear_to_color(al_map_rgb(0,0,0));
 	al_draw_bitmap(game->about.image, 0, 0, 0);
 	al_draw_bitmap(game->about.letter, game->viewportWidth*0.3, -game->viewportHeight*0.1, 0);
-	ALLEGRO_BITMAP* subbitmap;
-	subbitmap = al_create_sub_bitmap(game->about.text_bitmap, 0, 0, al_get_bitmap_width(game->about.text_bitmap), game->viewportHeight);
-	al_draw_rotated_bitmap(subbitmap, al_get_bitmap_width(subbitmap)/2.0, al_get_bitmap_height(subbitmap)/2.0, game->viewportWidth*0.5+al_get_bitmap_width(subbitmap)/2.0, game->viewportHeight*0.1+al_get_bitmap_height(subbitmap)/2.0, -0.11, 0);
-	al_destroy_bitmap(subbitmap);
+	DrawCredits(game, 0);
 
 	al_set_target_bitmap(al_get_backbuffer(game->display));
 	PROGRESS;
@@ -210,11 +270,13 @@ void About_Unload(struct Game *game) {
 	if (game->about.fadeloop!=0) {
 		FadeGameState(game, false);
 	}
-	al_destroy_bitmap(game->about.image);
-	al_destroy_bitmap(game->about.letter);
-	if (game->about.fadeloop>=0) al_destroy_bitmap(game->about.fade_bitmap);
-	al_destroy_bitmap(game->about.text_bitmap);
-	al_destroy_sample_instance(game->about.music);
-	al_destroy_sample(game->about.sample);
-	al_destroy_font(game->about.font);
+	Assets_Release(game, game->about.image);
+	Assets_Release(game, game->about.letter);
+	if (game->about.fadeloop>=0) Pool_Release(game, game->about.fade_bitmap);
+	int i;
+	for (i=0; i<ABOUT_STRIPS; i++) {
+		al_destroy_bitmap(game->about.strips[i]);
+	}
+	free(game->about.lines);
+	al_destroy_audio_stream(game->about.music);
 }
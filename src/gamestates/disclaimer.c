@@ -19,17 +19,21 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 #include <stdio.h>
+#include "../font.h"
+#include "../text.h"
 #include "intro.h"
 #include "menu.h"
 #include "about.h"
 
 void Disclaimer_Draw(struct Game *game) {
 	al_clear_to_color(al_map_rgb(0,0,0));
-	al_draw_text_with_shadow(game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.3, ALLEGRO_ALIGN_CENTRE, "This is an early development preview of the game.");
-	al_draw_text_with_shadow(game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.4, ALLEGRO_ALIGN_CENTRE, "It's not supposed to be complete!");
-	al_draw_text_with_shadow(game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Keep in mind that everything may be changed");
-	al_draw_text_with_shadow(game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "and many things surely will change.");
-	al_draw_text_with_shadow(game->menu.font, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.9, ALLEGRO_ALIGN_CENTRE, "Press any key to continue...");
+	al_hold_bitmap_drawing(true);
+	Text_DrawWithShadow(game, game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.3, ALLEGRO_ALIGN_CENTRE, "This is an early development preview of the game.");
+	Text_DrawWithShadow(game, game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.4, ALLEGRO_ALIGN_CENTRE, "It's not supposed to be complete!");
+	Text_DrawWithShadow(game, game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Keep in mind that everything may be changed");
+	Text_DrawWithShadow(game, game->menu.font_selected, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "and many things surely will change.");
+	Text_DrawWithShadow(game, game->menu.font, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight*0.9, ALLEGRO_ALIGN_CENTRE, "Press any key to continue...");
+	al_hold_bitmap_drawing(false);
 }
 
 void Disclaimer_Load(struct Game *game) {
@@ -45,8 +49,8 @@ int Disclaimer_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 
 void Disclaimer_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	if (!game->menu.loaded) {
-		game->menu.font = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.05,0 );
-		game->menu.font_selected = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.065,0 );
+		game->menu.font = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.05);
+		game->menu.font_selected = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.065);
 	}
 	PrintConsole(game, "Preloading GAMESTATE_INTRO...");
 	Intro_Preload(game, progress);
@@ -54,8 +58,4 @@ void Disclaimer_Preload(struct Game *game, void (*progress)(struct Game*, float)
 
 void Disclaimer_Unload(struct Game *game) {
 	FadeGameState(game, false);
-	if (!game->menu.loaded) {
-		al_destroy_font(game->menu.font);
-		al_destroy_font(game->menu.font_selected);
-	}
 }
@@ -20,9 +20,15 @@
  */
 #include <math.h>
 #include <stdio.h>
+#include "../font.h"
+#include "../archive.h"
+#include "../pool.h"
 #include "intro.h"
 #include "map.h"
 
+/*! \brief Number of pages in the story. */
+#define INTRO_PAGES 5
+
 void AnimPage(struct Game *game, int page, ALLEGRO_COLOR tint) {
 	int offset = 0;
 	if (game->intro.in_animation) offset = -1*game->viewportWidth + (cos(((-1*((game->intro.position)%game->viewportWidth))/(float)game->viewportWidth)*(ALLEGRO_PI))/2.0)*game->viewportWidth + game->viewportWidth/2.0;
@@ -45,99 +51,149 @@ void AnimPage(struct Game *game, int page, ALLEGRO_COLOR tint) {
 	if (page<5) al_draw_tinted_bitmap_region(game->intro.animsprites[page],tint,game->viewportHeight*1.6*0.3125*(int)fmod(anim,amount1),game->viewportHeight*0.63*(((int)(anim/amount1))%amount2),game->viewportHeight*1.6*0.3125, game->viewportHeight*0.63,offset+game->viewportWidth*1.08, game->viewportHeight*0.18,0);
 }
 
-void FillPage(struct Game *game, int page) {
-	char filename[30] = { };
-	sprintf(filename, "intro/%d.flac", page);
-
-	game->intro.audiostream = al_load_audio_stream(GetDataFilePath(filename), 4, 1024);
-	al_attach_audio_stream_to_mixer(game->intro.audiostream, game->audio.voice);
-	al_set_audio_stream_playing(game->intro.audiostream, false);
-	al_set_audio_stream_gain(game->intro.audiostream, 1.75);
-
-	al_set_target_bitmap(game->intro.table);
+/*! \brief Draws given page on the target bitmap. Pages out of the story are left blank. */
+void DrawPage(struct Game *game, int page) {
 	float y = 0.2;
-	float oldx = -1;
-	void draw_text(int page, char* text) {
-		float x = 0.45;
-		if (page!=oldx) { y=0.2; oldx=page; }
-		al_draw_text_with_shadow(game->intro.font, al_map_rgb(255,255,255), game->viewportWidth*x, game->viewportHeight*y, ALLEGRO_ALIGN_LEFT, text);
+	void draw_text(char* text) {
+		al_draw_text_with_shadow(game->intro.font, al_map_rgb(255,255,255), game->viewportWidth*0.45, game->viewportHeight*y, ALLEGRO_ALIGN_LEFT, text);
 		y+=0.07;
 	}
-	
-	void DrawPage(int p) {
-		switch (p) {
-			case 1:
-				al_hold_bitmap_drawing(true);
-				al_draw_bitmap(game->intro.table_bitmap, 0, 0, 0);
-				al_hold_bitmap_drawing(true);
-				draw_text(1, "Ever since Twilight Sparkle and her");
-				draw_text(1, "friends imprisoned Discord in stone,");
-				draw_text(1, "Equestria had been peaceful for");
-				draw_text(1, "a long time.");
-				al_hold_bitmap_drawing(false);
-				break;
-			case 2:
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
-				al_hold_bitmap_drawing(false);
-				al_hold_bitmap_drawing(true);
-				draw_text(2, "Until one day a reckless pony caused");
-				draw_text(2, "a tiny bit of chaos near Discord’s");
-				draw_text(2, "statue.");
-				al_hold_bitmap_drawing(false);
-				break;
-			case 3:
-				al_hold_bitmap_drawing(true);
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
-				al_hold_bitmap_drawing(false);
-				al_hold_bitmap_drawing(true);
-				draw_text(3, "This small amount of chaos was not");
-				draw_text(3, "enough to free Discord, but enough");
-				draw_text(3, "to turn discarded muffins into");
-				draw_text(3, "vicious muffinzombies, with aim to");
-				draw_text(3, "destroy all harmony in Equestria.");
-				al_hold_bitmap_drawing(false);
-				break;
-			case 4:
-				al_hold_bitmap_drawing(true);
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
-				al_hold_bitmap_drawing(false);
-				al_hold_bitmap_drawing(true);
-				draw_text(4, "Discord, learning from his last failure,");
-				draw_text(4, "turned his muffinzombies against Twilight");
-				draw_text(4, "and her friends, trapping them in their");
-				draw_text(4, "own homes. With the bearers of the");
-				draw_text(4, "Elements out of the way, he now waits");
-				draw_text(4, "until chaos takes hold of the world,");
-				draw_text(4, "so he can rule Equestria once again.");
-				al_hold_bitmap_drawing(false);
-				break;
-			case 5:
-				al_hold_bitmap_drawing(true);
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
-				al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
-				al_hold_bitmap_drawing(false);
-				al_hold_bitmap_drawing(true);
-				draw_text(5, "Who can defeat Discord without");
-				draw_text(5, "the Elements of Harmony?");
-				draw_text(5, "");
-				draw_text(5, "Well... There is somepony who knows");
-				draw_text(5, "all about muffins...");
-				al_hold_bitmap_drawing(false);
-				break;
-		}
+
+	al_clear_to_color(al_map_rgba(0,0,0,0));
+	switch (page) {
+		case 1:
+			al_hold_bitmap_drawing(true);
+			al_draw_bitmap(game->intro.table_bitmap, 0, 0, 0);
+			al_hold_bitmap_drawing(true);
+			draw_text("Ever since Twilight Sparkle and her");
+			draw_text("friends imprisoned Discord in stone,");
+			draw_text("Equestria had been peaceful for");
+			draw_text("a long time.");
+			al_hold_bitmap_drawing(false);
+			break;
+		case 2:
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
+			al_hold_bitmap_drawing(false);
+			al_hold_bitmap_drawing(true);
+			draw_text("Until one day a reckless pony caused");
+			draw_text("a tiny bit of chaos near Discord’s");
+			draw_text("statue.");
+			al_hold_bitmap_drawing(false);
+			break;
+		case 3:
+			al_hold_bitmap_drawing(true);
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
+			al_hold_bitmap_drawing(false);
+			al_hold_bitmap_drawing(true);
+			draw_text("This small amount of chaos was not");
+			draw_text("enough to free Discord, but enough");
+			draw_text("to turn discarded muffins into");
+			draw_text("vicious muffinzombies, with aim to");
+			draw_text("destroy all harmony in Equestria.");
+			al_hold_bitmap_drawing(false);
+			break;
+		case 4:
+			al_hold_bitmap_drawing(true);
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
+			al_hold_bitmap_drawing(false);
+			al_hold_bitmap_drawing(true);
+			draw_text("Discord, learning from his last failure,");
+			draw_text("turned his muffinzombies against Twilight");
+			draw_text("and her friends, trapping them in their");
+			draw_text("own homes. With the bearers of the");
+			draw_text("Elements out of the way, he now waits");
+			draw_text("until chaos takes hold of the world,");
+			draw_text("so he can rule Equestria once again.");
+			al_hold_bitmap_drawing(false);
+			break;
+		case 5:
+			al_hold_bitmap_drawing(true);
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0, 0, 0);
+			al_draw_bitmap_region(game->intro.table_bitmap, al_get_bitmap_width(game->intro.table_bitmap)/2, 0, al_get_bitmap_width(game->intro.table_bitmap)/2, al_get_bitmap_height(game->intro.table_bitmap), game->viewportWidth*0.5, 0, 0);
+			al_hold_bitmap_drawing(false);
+			al_hold_bitmap_drawing(true);
+			draw_text("Who can defeat Discord without");
+			draw_text("the Elements of Harmony?");
+			draw_text("");
+			draw_text("Well... There is somepony who knows");
+			draw_text("all about muffins...");
+			al_hold_bitmap_drawing(false);
+			break;
 	}
+}
 
-	DrawPage(page);
-	ALLEGRO_BITMAP* second = al_create_bitmap(game->viewportWidth, game->viewportHeight);
-	al_set_target_bitmap(second);
-	DrawPage(page+1);
-	al_set_target_bitmap(game->intro.table);
-	al_draw_bitmap(second, game->viewportWidth, 0, 0);
-	al_set_target_bitmap(al_get_backbuffer(game->display));
-	al_destroy_bitmap(second);
+/*! \brief Renders given page into left (0) or right (1) half of two pages long table. */
+void RenderPage(struct Game *game, ALLEGRO_BITMAP *table, int half, int page) {
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
+	ALLEGRO_BITMAP *sub = al_create_sub_bitmap(table, half*game->viewportWidth, 0, game->viewportWidth, game->viewportHeight);
+	al_set_target_bitmap(sub);
+	DrawPage(game, page);
+	al_set_target_bitmap(target);
+	al_destroy_bitmap(sub);
+}
+
+/*! \brief Renders one more page of the table shown after next page turn. Returns true if it's complete. */
+bool RenderAhead(struct Game *game) {
+	if (game->intro.next_rendered == 2) return true;
+	RenderPage(game, game->intro.next_table, game->intro.next_rendered, game->intro.next_page + game->intro.next_rendered);
+	game->intro.next_rendered++;
+	return game->intro.next_rendered == 2;
+}
+
+/*! \brief Opens voice-over of next page in background, as opening and prebuffering a stream takes several frames. */
+void* IntroStreamThread(ALLEGRO_THREAD *thread, void *arg) {
+	struct Game *game = arg;
+	char filename[30] = { };
+	sprintf(filename, "intro/%d.flac", game->intro.stream_page);
+	Archive_UseFileInterface();
+	char* path = GetDataFilePath(filename);
+	game->intro.next_stream = al_load_audio_stream(path, 4, 1024);
+	free(path);
+	return NULL;
+}
+
+/*! \brief Starts opening voice-over of given page, if the story has such page. */
+void OpenStreamAhead(struct Game *game, int page) {
+	game->intro.next_stream = NULL;
+	game->intro.stream_thread = NULL;
+	if (page > INTRO_PAGES) return;
+	game->intro.stream_page = page;
+	game->intro.stream_thread = al_create_thread(IntroStreamThread, game);
+	if (game->intro.stream_thread) al_start_thread(game->intro.stream_thread);
+	else IntroStreamThread(NULL, game);
+}
+
+/*! \brief Waits until voice-over opened in background is ready and returns it. */
+ALLEGRO_AUDIO_STREAM* TakeStream(struct Game *game) {
+	if (game->intro.stream_thread) {
+		al_join_thread(game->intro.stream_thread, NULL);
+		al_destroy_thread(game->intro.stream_thread);
+		game->intro.stream_thread = NULL;
+	}
+	ALLEGRO_AUDIO_STREAM *stream = game->intro.next_stream;
+	game->intro.next_stream = NULL;
+	return stream;
+}
+
+/*! \brief Shows the table rendered ahead with its voice-over, and starts preparing the following page. */
+void TurnPage(struct Game *game) {
+	/* normally everything is done long before the page turn finishes */
+	while (!RenderAhead(game)) {}
+	ALLEGRO_BITMAP *tmp = game->intro.table;
+	game->intro.table = game->intro.next_table;
+	game->intro.next_table = tmp;
+	game->intro.next_page++;
+	game->intro.next_rendered = 0;
+	game->intro.audiostream = TakeStream(game);
+	if (game->intro.audiostream) {
+		al_attach_audio_stream_to_mixer(game->intro.audiostream, game->audio.voice);
+		al_set_audio_stream_playing(game->intro.audiostream, false);
+		al_set_audio_stream_gain(game->intro.audiostream, 1.75);
+	}
+	OpenStreamAhead(game, game->intro.next_page);
 }
 
 void Intro_Logic(struct Game *game) {
@@ -147,14 +203,16 @@ void Intro_Logic(struct Game *game) {
 		game->intro.position -= 10;
 		if (game->intro.position%game->viewportWidth>old) {
 			game->intro.in_animation = false;
-			FillPage(game, game->intro.page+1);
+			TurnPage(game);
 			PrintConsole(game, "Animation finished.");
-			al_set_audio_stream_playing(game->intro.audiostream, true);
+			if (game->intro.audiostream) al_set_audio_stream_playing(game->intro.audiostream, true);
 		}
 	}
 }
 
 void Intro_Draw(struct Game *game) {
+	/* pages shown after next turn are rendered one per frame, well before they're needed */
+	RenderAhead(game);
 	al_clear_to_color(al_map_rgb(0,0,0));
 	if (game->intro.in_animation) {
 		al_draw_bitmap(game->intro.table, -1*game->viewportWidth + (cos(((-1*((game->intro.position)%game->viewportWidth))/(float)game->viewportWidth)*(ALLEGRO_PI))/2.0)*game->viewportWidth + game->viewportWidth/2.0, 0, 0);
@@ -179,7 +237,7 @@ void Intro_Draw(struct Game *game) {
 }
 
 void Intro_Load(struct Game *game) {
-	al_play_sample_instance(game->intro.music);
+	al_set_audio_stream_playing(game->intro.music, true);
 	FadeGameState(game, true);
 	al_set_audio_stream_playing(game->intro.audiostream, true);
 }
@@ -229,23 +287,20 @@ void Intro_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	game->intro.frame =LoadScaledBitmap("intro/frame.png", game->viewportWidth, game->viewportHeight);
 	PROGRESS;
 
-	game->intro.sample = al_load_sample( GetDataFilePath("intro/intro.flac") );
+	game->intro.music = LoadMusic(game, "intro/intro.flac");
+	al_set_audio_stream_gain(game->intro.music, 0.75);
 	PROGRESS;
 
-	game->intro.music = al_create_sample_instance(game->intro.sample);
-	al_attach_sample_instance_to_mixer(game->intro.music, game->audio.music);
-	al_set_sample_instance_gain(game->intro.music, 0.75);
-	al_set_sample_instance_playmode(game->intro.music, ALLEGRO_PLAYMODE_LOOP);
-
-	if (!game->intro.sample){
-		fprintf(stderr, "Audio clip sample not loaded!\n" );
-		exit(-1);
-	}
-	game->intro.table = al_create_bitmap(game->viewportWidth*2, game->viewportHeight);
+	game->intro.table = Pool_Acquire(game, game->viewportWidth*2, game->viewportHeight);
+	game->intro.next_table = Pool_Acquire(game, game->viewportWidth*2, game->viewportHeight);
 
-	game->intro.font = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.04,0 );
+	game->intro.font = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.04);
 
-	FillPage(game, 1);
+	/* first page is turned right here, so it's ready when the intro starts */
+	game->intro.next_page = 1;
+	game->intro.next_rendered = 0;
+	OpenStreamAhead(game, 1);
+	TurnPage(game);
 	PROGRESS;
 	al_set_target_bitmap(al_get_backbuffer(game->display));
 	PrintConsole(game, "Chainpreloading GAMESTATE_MAP...");
@@ -262,14 +317,15 @@ void Intro_Unload(struct Game *game) {
 		al_set_audio_stream_playing(game->intro.audiostream, false);
 		al_destroy_audio_stream(game->intro.audiostream);
 	}
+	ALLEGRO_AUDIO_STREAM *next = TakeStream(game);
+	if (next) al_destroy_audio_stream(next);
 	al_destroy_bitmap(game->intro.frame);
-	al_destroy_bitmap(game->intro.table);
+	Pool_Release(game, game->intro.table);
+	Pool_Release(game, game->intro.next_table);
 	int i;
 	for (i=0; i<5; i++) {
 		al_destroy_bitmap(game->intro.animsprites[i]);
 	}
-	al_destroy_font(game->intro.font);
-	al_destroy_sample_instance(game->intro.music);
-	al_destroy_sample(game->intro.sample);
+	al_destroy_audio_stream(game->intro.music);
 	al_destroy_bitmap(game->intro.table_bitmap);
 }
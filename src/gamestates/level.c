@@ -20,6 +20,7 @@
  */
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
 #include "../levels/level1.h"
 #include "../levels/level2.h"
 #include "../levels/level3.h"
@@ -27,105 +28,248 @@
 #include "../levels/level5.h"
 #include "../levels/level6.h"
 #include "../config.h"
+#include "../replay.h"
+#include "../prefetch.h"
+#include "../bake.h"
+#include "../pool.h"
 #include "pause.h"
 #include "level.h"
 #include "../timeline.h"
 
-#define LEVELS(name, ...) switch (game->level.current_level) { \
-	case 1: \
-	Level1_ ## name (__VA_ARGS__); break;\
-	case 2: \
-	Level2_ ## name (__VA_ARGS__); break;\
-	case 3: \
-	Level3_ ## name (__VA_ARGS__); break;\
-	case 4: \
-	Level4_ ## name (__VA_ARGS__); break;\
-	case 5: \
-	Level5_ ## name (__VA_ARGS__); break;\
-	case 6: \
-	Level6_ ## name (__VA_ARGS__); break;\
-}
+/*! \brief Fills level descriptor with callbacks of level n. */
+#define LEVEL(n) { &Level ## n ## _Preload, &Level ## n ## _PreloadBitmaps, &Level ## n ## _Prefetch, &Level ## n ## _PreloadSteps, &Level ## n ## _Load, \
+	&Level ## n ## _Unload, &Level ## n ## _UnloadBitmaps, &Level ## n ## _Draw, &Level ## n ## _Logic, &Level ## n ## _Keydown, \
+	&Level ## n ## _ProcessEvent, &Level ## n ## _Pause, &Level ## n ## _Resume }
+
+/*! \brief Table of all levels, indexed by level number minus one. */
+struct LevelDescriptor levels[] = { LEVEL(1), LEVEL(2), LEVEL(3), LEVEL(4), LEVEL(5), LEVEL(6) };
+
+/*! \brief Number of available levels. */
+#define LEVELS_COUNT (int)(sizeof(levels)/sizeof(levels[0]))
 
-void SelectDerpySpritesheet(struct Game *game, char* name) {
-	struct Spritesheet *tmp = game->level.derpy_sheets;
-	PrintConsole(game, "Selecting Derpy spritesheet: %s", name);
-	if (!tmp) {
-		PrintConsole(game, "ERROR: No spritesheets registered for Derpy!");
+/*! \brief Number of actions at the front of the main queue scanned for spritesheets they're going to select. */
+#define LEVEL_SHEET_LOOKAHEAD 4
+
+/*! \brief Loads manifest of Derpy spritesheets, unless it's already been loaded. */
+void LoadDerpySpritesheets(struct Game *game) {
+	if (game->spritesheets.list) return;
+	char* path = GetDataFilePath("levels/derpy/animations.ini");
+	ALLEGRO_CONFIG *config = al_load_config_file(path);
+	free(path);
+	if (!config) {
+		PrintConsole(game, "ERROR: Could not load manifest of Derpy spritesheets!");
 		return;
 	}
-	while (tmp) {
-		if (!strcmp(tmp->name, name)) {
-			game->level.derpy_sheet = &(tmp->bitmap);
-			game->level.sheet_rows = tmp->rows;
-			game->level.sheet_cols = tmp->cols;
-			game->level.sheet_blanks = tmp->blanks;
-			game->level.sheet_speed_modifier = tmp->speed;
-			game->level.sheet_pos = 0;
-			game->level.sheet_scale = tmp->scale;
-			game->level.sheet_successor = tmp->successor;
-			if (game->level.derpy) al_destroy_bitmap(game->level.derpy);
-			game->level.derpy = al_create_bitmap((game->viewportHeight*0.25)*tmp->aspect*tmp->scale, (game->viewportHeight*0.25)*tmp->scale);
-			PrintConsole(game, "SUCCESS: Derpy spritesheet activated: %s (%dx%d)", name, al_get_bitmap_width(game->level.derpy), al_get_bitmap_height(game->level.derpy));
-			return;
+	ALLEGRO_CONFIG_SECTION *it;
+	char const *section;
+	int i = 0, count = 0;
+	for (section = al_get_first_config_section(config, &it); section; section = al_get_next_config_section(&it)) {
+		if (section[0]) count++;
+	}
+	struct Spritesheet *list = calloc(count ? count : 1, sizeof(struct Spritesheet));
+	for (section = al_get_first_config_section(config, &it); section; section = al_get_next_config_section(&it)) {
+		if (!section[0]) continue;
+		struct Spritesheet *s = &list[i++];
+		s->name = strdup(section);
+		s->cols = atoi(al_get_config_value(config, section, "cols"));
+		s->rows = atoi(al_get_config_value(config, section, "rows"));
+		s->blanks = atoi(al_get_config_value(config, section, "blanks"));
+		s->speed = atof(al_get_config_value(config, section, "speed"));
+		s->aspect = atof(al_get_config_value(config, section, "aspect"));
+		s->scale = atof(al_get_config_value(config, section, "scale"));
+	}
+	game->spritesheets.list = list;
+	game->spritesheets.count = count;
+	/* successors are resolved once all names are known, so switching to them is just an index */
+	for (i=0; i<count; i++) {
+		const char* successor = al_get_config_value(config, list[i].name, "successor");
+		list[i].successor = ((successor) && (successor[0])) ? FindDerpySpritesheet(game, (char*)successor) : -1;
+		if ((successor) && (successor[0]) && (list[i].successor < 0)) {
+			PrintConsole(game, "ERROR: Unknown successor %s of Derpy spritesheet %s!", successor, list[i].name);
 		}
-		tmp = tmp->next;
 	}
-	PrintConsole(game, "ERROR: No spritesheets registered for Derpy with given name: %s", name);
-	return;
+	al_destroy_config(config);
+	PrintConsole(game, "Loaded manifest of %d Derpy spritesheets.", count);
+}
+
+void FreeDerpySpritesheets(struct Game *game) {
+	int i;
+	for (i=0; i<game->spritesheets.count; i++) {
+		free(game->spritesheets.list[i].name);
+	}
+	free(game->spritesheets.list);
+	game->spritesheets.list = NULL;
+	game->spritesheets.count = 0;
+}
+
+int FindDerpySpritesheet(struct Game *game, char* name) {
+	int i;
+	LoadDerpySpritesheets(game);
+	for (i=0; i<game->spritesheets.count; i++) {
+		if (!strcmp(game->spritesheets.list[i].name, name)) return i;
+	}
+	return -1;
+}
+
+/*! \brief Calculates size of a single frame of the spritesheet, in pixels. */
+void DerpyFrameSize(struct Game *game, struct Spritesheet *s, int *width, int *height) {
+	*width = game->viewportHeight*0.25*s->aspect*s->scale;
+	*height = game->viewportHeight*0.25*s->scale;
+}
+
+/*! \brief Fills data filename and size of the spritesheet bitmap. */
+void DerpySpritesheetBitmap(struct Game *game, struct Spritesheet *s, char* filename, int *width, int *height) {
+	sprintf(filename, "levels/derpy/%s.png", s->name);
+	DerpyFrameSize(game, s, width, height);
+	*width *= s->cols;
+	*height *= s->rows;
 }
 
-void RegisterDerpySpritesheet(struct Game *game, char* name) {
-	struct Spritesheet *s = game->level.derpy_sheets;
-	while (s) {
-		if (!strcmp(s->name, name)) {
-			//PrintConsole(game, "Derpy spritesheet %s already registered!", name);
-			return;
+/*! \brief Loads bitmap of the spritesheet, taking it from prefetch worker if it has been requested. */
+void LoadDerpySpritesheet(struct Game *game, struct Spritesheet *s) {
+	char filename[255] = { };
+	int width, height;
+	DerpySpritesheetBitmap(game, s, filename, &width, &height);
+	s->bitmap = Prefetch_LoadBitmap(game, filename, width, height);
+	s->requested = false;
+}
+
+void SelectDerpySpritesheet(struct Game *game, int handle) {
+	if ((handle < 0) || (handle >= game->spritesheets.count)) return;
+	struct Spritesheet *s = &game->spritesheets.list[handle];
+	/* frames exist once level bitmaps are loaded; sheet which wasn't seen coming is loaded right away */
+	if ((s->frame) && (!s->bitmap)) LoadDerpySpritesheet(game, s);
+	game->level.sheet = handle;
+	game->level.derpy_sheet = &(s->bitmap);
+	game->level.derpy = s->frame;
+	game->level.sheet_rows = s->rows;
+	game->level.sheet_cols = s->cols;
+	game->level.sheet_blanks = s->blanks;
+	game->level.sheet_speed_modifier = s->speed;
+	game->level.sheet_pos = 0;
+	game->level.sheet_scale = s->scale;
+	game->level.sheet_successor = s->successor;
+}
+
+int RegisterDerpySpritesheet(struct Game *game, char* name) {
+	int handle = FindDerpySpritesheet(game, name), next = handle;
+	if (handle < 0) {
+		PrintConsole(game, "ERROR: No Derpy spritesheet with given name: %s", name);
+		return -1;
+	}
+	/* successors get played without asking, so they have to be loaded as well */
+	while ((next >= 0) && (!game->spritesheets.list[next].registered)) {
+		game->spritesheets.list[next].registered = true;
+		PrintConsole(game, "Registering Derpy spritesheet: %s", game->spritesheets.list[next].name);
+		next = game->spritesheets.list[next].successor;
+	}
+	return handle;
+}
+
+/*! \brief Loads spritesheets which are about to be selected and unloads ones which aren't needed anymore. */
+void UpdateDerpySpritesheets(struct Game *game) {
+	char filename[255] = { };
+	int i, width, height;
+	/* without display nothing gets drawn, so spritesheets are loaded only when selected */
+	if (!game->display) return;
+	for (i=0; i<game->spritesheets.count; i++) {
+		game->spritesheets.list[i].wanted = false;
+	}
+	void Want(int handle) {
+		/* one-shot animations switch to their successors without asking */
+		while ((handle >= 0) && (!game->spritesheets.list[handle].wanted)) {
+			game->spritesheets.list[handle].wanted = true;
+			handle = game->spritesheets.list[handle].successor;
+		}
+	}
+	void Scheduled(struct TM_Action *action, void *data) {
+		Want(action->spritesheet);
+	}
+	Want(game->level.sheet);
+	TM_Lookahead(LEVEL_SHEET_LOOKAHEAD, &Scheduled, NULL);
+
+	for (i=0; i<game->spritesheets.count; i++) {
+		struct Spritesheet *s = &game->spritesheets.list[i];
+		if (!s->registered) continue;
+		if ((s->wanted) ? (s->bitmap != NULL) : ((!s->bitmap) && (!s->requested))) continue;
+		DerpySpritesheetBitmap(game, s, filename, &width, &height);
+		if (!s->wanted) {
+			if (s->requested) Prefetch_Forget(game, filename, width, height);
+			s->requested = false;
+			if (s->bitmap) PrintConsole(game, "Unloading Derpy spritesheet: %s", s->name);
+			al_destroy_bitmap(s->bitmap);
+			s->bitmap = NULL;
+		} else if (!s->requested) {
+			PrintConsole(game, "Requesting Derpy spritesheet: %s", s->name);
+			Prefetch_Bitmap(game, filename, width, height);
+			Prefetch_End(game);
+			s->requested = true;
+		} else if (Prefetch_Ready(game, filename, width, height)) {
+			LoadDerpySpritesheet(game, s);
 		}
-		s = s->next;
 	}
+}
+
+void PrefetchDerpySpritesheet(struct Game *game, char* name) {
 	char filename[255] = { };
-	sprintf(filename, "levels/derpy/%s.ini", name);
-	ALLEGRO_CONFIG *config = al_load_config_file(GetDataFilePath(filename));
-	s = malloc(sizeof(struct Spritesheet));
-	s->name = malloc((strlen(name)+1)*sizeof(char));
-	strcpy(s->name, name);
-	s->bitmap = NULL;
-	s->cols = atoi(al_get_config_value(config, "", "cols"));
-	s->rows = atoi(al_get_config_value(config, "", "rows"));
-	s->blanks = atoi(al_get_config_value(config, "", "blanks"));
-	s->speed = atof(al_get_config_value(config, "", "speed"));
-	s->aspect = atof(al_get_config_value(config, "", "aspect"));
-	s->scale = atof(al_get_config_value(config, "", "scale"));
-	s->successor=NULL;
-	const char* successor = al_get_config_value(config, "", "successor");
-	if (successor) {
-		s->successor = malloc(255*sizeof(char));
-		strcpy(s->successor, successor);
-	}
-	s->next = game->level.derpy_sheets;
-	game->level.derpy_sheets = s;
-	al_destroy_config(config);
-	PrintConsole(game, "Registering Derpy spritesheet: %s", name);
+	int handle = FindDerpySpritesheet(game, name), width, height;
+	if (handle < 0) return;
+	DerpySpritesheetBitmap(game, &game->spritesheets.list[handle], filename, &width, &height);
+	Prefetch_Bitmap(game, filename, width, height);
+}
+
+void Level_Prefetch(struct Game *game, int level) {
+	if ((level < 1) || (level > LEVELS_COUNT)) return;
+	char* layers[] = { "clouds", "foreground", "background", "stage" };
+	char filename[255] = { };
+	int i;
+	Prefetch_Begin(game);
+	PrefetchDerpySpritesheet(game, "stand");
+	for (i=0; i<4; i++) {
+		sprintf(filename, "levels/%d/%s.png", level, layers[i]);
+		Prefetch_Bitmap(game, filename, game->viewportHeight*4.73307291666666666667, game->viewportHeight);
+	}
+	Prefetch_Bitmap(game, "levels/meter.png", game->viewportWidth*0.075, game->viewportWidth*0.075*0.96470588235294117647);
+	levels[level-1].Prefetch(game);
+	Prefetch_End(game);
 }
 
 void Level_Passed(struct Game *game) {
+	/* simulated and replayed runs don't unlock anything */
+	if ((!game->display) || (Replay_Playing(game))) return;
 	if (game->level.current_level<6) {
-		int available = atoi(GetConfigOptionDefault("MuffinAttack", "level", "1"));
+		int available = GetConfigInt("MuffinAttack", "level", 1);
 		available++;
 		if ((available<2) || (available>7)) available=1;
 		if (available==(game->level.current_level+1)) {
-			char* text = malloc(2*sizeof(char));
-			sprintf(text, "%d", available);
-			SetConfigOption("MuffinAttack", "level", text);
-			free(text);
+			SetConfigInt("MuffinAttack", "level", available);
 		}
 	} else {
-		SetConfigOption("MuffinAttack", "completed", "1");
+		SetConfigInt("MuffinAttack", "completed", 1);
+	}
+}
+
+/*! \brief Samples player input for current logic tick, from keyboard or from replay. */
+unsigned char SampleInput(struct Game *game) {
+	unsigned char keys = 0;
+	if (game->display) {
+		struct ALLEGRO_KEYBOARD_STATE keyboard;
+		al_get_keyboard_state(&keyboard);
+		if (al_key_down(&keyboard, ALLEGRO_KEY_UP)) keys |= INPUT_UP;
+		if (al_key_down(&keyboard, ALLEGRO_KEY_DOWN)) keys |= INPUT_DOWN;
+		if (al_key_down(&keyboard, ALLEGRO_KEY_LEFT)) keys |= INPUT_LEFT;
+		if (al_key_down(&keyboard, ALLEGRO_KEY_RIGHT)) keys |= INPUT_RIGHT;
+		if (al_key_down(&keyboard, ALLEGRO_KEY_ENTER)) keys |= INPUT_ENTER;
 	}
+	if (game->level.input.bot) keys = game->level.input.bot(game);
+	return Replay_Input(game, keys);
 }
 
 void Level_Logic(struct Game *game) {
-	LEVELS(Logic, game);
+	game->level.keys_prev = game->level.keys;
+	game->level.keys = SampleInput(game);
+
+	game->level.descriptor->Logic(game);
 
 	if ((game->level.sheet_speed) && (game->level.sheet_speed_modifier)) {
 		game->level.sheet_tmp+=1;
@@ -135,7 +279,7 @@ void Level_Logic(struct Game *game) {
 		}
 		if (game->level.sheet_pos>=game->level.sheet_cols*game->level.sheet_rows-game->level.sheet_blanks) {
 			game->level.sheet_pos=0;
-			if (game->level.sheet_successor) {
+			if (game->level.sheet_successor >= 0) {
 				SelectDerpySpritesheet(game, game->level.sheet_successor);
 			}
 		}
@@ -154,19 +298,27 @@ void Level_Logic(struct Game *game) {
 	if (game->level.cl_pos >= 1) game->level.cl_pos=game->level.cl_pos-1;
 
 	TM_Process();
+	/* timeline is rebuilt from scratch, so it can't happen while it's being processed */
+	if (game->level.retry) Level_Restart(game);
+	UpdateDerpySpritesheets(game);
+
+	if ((Replay_Ended(game)) && (!game->level.unloading)) {
+		PrintConsole(game, "Replay: level run has been ended by the player here.");
+		Level_Unload(game);
+		game->gamestate = GAMESTATE_LOADING;
+		game->loadstate = GAMESTATE_MAP;
+	}
 }
 
 void Level_Resume(struct Game *game) {
-	al_set_sample_instance_position(game->level.music, game->level.music_pos);
-	al_set_sample_instance_playing(game->level.music, true);
-	LEVELS(Resume, game);
+	if (game->level.music) al_set_audio_stream_playing(game->level.music, true);
+	game->level.descriptor->Resume(game);
 	TM_Resume();
 }
 
 void Level_Pause(struct Game *game) {
-	game->level.music_pos = al_get_sample_instance_position(game->level.music);
-	al_set_sample_instance_playing(game->level.music, false);
-	LEVELS(Pause, game);
+	if (game->level.music) al_set_audio_stream_playing(game->level.music, false);
+	game->level.descriptor->Pause(game);
 	TM_Pause();
 }
 
@@ -178,7 +330,7 @@ void Level_Draw(struct Game *game) {
 	al_draw_bitmap(game->level.stage, (-game->level.st_pos)*al_get_bitmap_width(game->level.stage), 0 ,0);
 	al_draw_bitmap(game->level.stage, (1+(-game->level.st_pos))*al_get_bitmap_width(game->level.stage), 0 ,0);
 
-	LEVELS(Draw, game);
+	game->level.descriptor->Draw(game);
 
 	if (!game->level.foreground) return;
 
@@ -196,11 +348,13 @@ void Level_Draw(struct Game *game) {
 	al_draw_tinted_bitmap(game->level.meter_bmp, al_map_rgba(game->level.meter_alpha,game->level.meter_alpha,game->level.meter_alpha,game->level.meter_alpha), game->viewportWidth*0.95-al_get_bitmap_width(game->level.meter_bmp), game->viewportHeight*0.975-al_get_bitmap_height(game->level.meter_bmp), 0);
 
 	TM_Draw();
+	if (game->level.debug_show_timeline) TM_DrawDebug();
 }
 
 
 void Level_Load(struct Game *game) {
 	game->level.failed=false;
+	game->level.retry=false;
 	game->level.hp=1;
 	game->level.cl_pos=0;
 	game->level.bg_pos=0;
@@ -216,9 +370,17 @@ void Level_Load(struct Game *game) {
 	game->level.handle_input = false;
 	game->level.meter_alpha=0;
 	game->level.debug_show_sprite_frames=false;
-	al_clear_to_color(al_map_rgb(0,0,0));
+	game->level.debug_show_timeline=false;
+	game->level.keys = 0;
+	game->level.keys_prev = 0;
+	game->level.dodger.obstacles = NULL;
+	game->level.seed = game->level.input.seed ? game->level.input.seed : time(NULL);
+	Replay_Start(game);
+	RNG_Seed(&game->level.rng.obstacles, game->level.seed, RNG_STREAM_OBSTACLES);
+	PrintConsole(game, "Level %d seed: %u", game->level.current_level, game->level.seed);
+	if (game->display) al_clear_to_color(al_map_rgb(0,0,0));
 	TM_Init(game);
-	LEVELS(Load, game);
+	game->level.descriptor->Load(game);
 }
 
 int Level_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
@@ -230,20 +392,20 @@ int Level_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 		if (game->level.hp > 1) game->level.hp=1;
 	} else if ((game->debug) && (ev->keyboard.keycode==ALLEGRO_KEY_F4)) {
 		game->level.debug_show_sprite_frames = !game->level.debug_show_sprite_frames;
+	} else if ((game->debug) && (ev->keyboard.keycode==ALLEGRO_KEY_F5)) {
+		game->level.debug_show_timeline = !game->level.debug_show_timeline;
+	} else if ((game->debug) && (ev->keyboard.keycode==ALLEGRO_KEY_F6)) {
+		TM_Dump();
 	}
-	LEVELS(Keydown, game, ev);
+	game->level.descriptor->Keydown(game, ev);
 	if (ev->keyboard.keycode==ALLEGRO_KEY_ESCAPE) {
-		game->gamestate = GAMESTATE_PAUSE;
-		game->loadstate = GAMESTATE_LEVEL;
-		PauseGameState(game);
-		Pause_Load(game);
+		PushGameState(game, GAMESTATE_PAUSE);
 	}
 	return 0;
 }
 
 void Level_ProcessEvent(struct Game *game, ALLEGRO_EVENT *ev) {
-	LEVELS(ProcessEvent, game, ev);
-	TM_HandleEvent(ev);
+	game->level.descriptor->ProcessEvent(game, ev);
 }
 
 char* GetLevelFilename(struct Game *game, char* filename) {
@@ -257,119 +419,160 @@ void Level_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	PrintConsole(game, "Initializing level %d...", game->level.input.current_level);
 
 	game->level.current_level = game->level.input.current_level;
-	game->level.derpy_sheets = NULL;
+	if ((game->level.current_level < 1) || (game->level.current_level > LEVELS_COUNT)) {
+		PrintConsole(game, "ERROR: Attempted to load unknown level %d! Loading level 1 instead...", game->level.current_level);
+		game->level.current_level = 1;
+	}
+	game->level.descriptor = &levels[game->level.current_level-1];
 	game->level.derpy = NULL;
+	game->level.derpy_frames = NULL;
+	game->level.sheet = -1;
 	game->level.unloading = false;
-	Pause_Preload(game);
-	RegisterDerpySpritesheet(game, "stand"); // default
-
-	game->level.sample = al_load_sample( GetDataFilePath(GetLevelFilename(game, "levels/?/music.flac")) );
-
-	LEVELS(Preload, game);
-
-	Level_PreloadBitmaps(game, progress);
-
-	game->level.music = al_create_sample_instance(game->level.sample);
-	al_attach_sample_instance_to_mixer(game->level.music, game->audio.music);
-	al_set_sample_instance_playmode(game->level.music, ALLEGRO_PLAYMODE_LOOP);
-
-	if (!game->level.sample){
-		fprintf(stderr, "Audio clip sample not loaded!\n" );
-		exit(-1);
+	game->level.music = NULL;
+	/* without display there's nothing to show or hear, so only gameplay resources are loaded */
+	if (game->display) Pause_Preload(game);
+	game->level.sheet_stand = RegisterDerpySpritesheet(game, "stand"); // default
+	SelectDerpySpritesheet(game, game->level.sheet_stand);
+
+	game->level.descriptor->Preload(game);
+
+	/* level may have chosen its own music already */
+	if ((game->display) && (!game->level.music)) {
+		char* filename = GetLevelFilename(game, "levels/?/music.flac");
+		game->level.music = LoadMusic(game, filename);
+		free(filename);
 	}
 
+	Level_PreloadBitmaps(game, progress);
 }
 
 void Level_Unload(struct Game *game) {
 	if (game->level.unloading) return;
 	game->level.unloading = true;
-	Pause_Unload_Real(game);
-	FadeGameState(game, false);
-	al_destroy_sample_instance(game->level.music);
-	al_destroy_sample(game->level.sample);
+	Replay_Stop(game);
+	if (game->display) {
+		Pause_Unload_Real(game);
+		FadeGameState(game, false);
+		al_destroy_audio_stream(game->level.music);
+	}
 	Level_UnloadBitmaps(game);
-	LEVELS(Unload, game);
+	game->level.descriptor->Unload(game);
 	TM_Destroy();
+	int i;
+	for (i=0; i<game->spritesheets.count; i++) {
+		game->spritesheets.list[i].registered = false;
+	}
 }
 
+void Level_Restart(struct Game *game) {
+	PrintConsole(game, "Restarting level %d...", game->level.current_level);
+	/* only simulation state is thrown away, bitmaps and sounds stay loaded */
+	game->level.descriptor->Unload(game);
+	TM_Destroy();
+	if (game->level.music) {
+		al_set_audio_stream_playing(game->level.music, false);
+		al_rewind_audio_stream(game->level.music);
+	}
+	SelectDerpySpritesheet(game, game->level.sheet_stand);
+	Level_Load(game);
+}
 
 void Level_UnloadBitmaps(struct Game *game) {
-	al_destroy_bitmap(game->level.derpy);
-	struct Spritesheet *tmp = game->level.derpy_sheets;
-	while (tmp) {
-		al_destroy_bitmap(tmp->bitmap);
-		tmp = tmp->next;
+	int i;
+	char filename[255] = { };
+	int width, height;
+	for (i=0; i<game->spritesheets.count; i++) {
+		struct Spritesheet *s = &game->spritesheets.list[i];
+		if (s->requested) {
+			DerpySpritesheetBitmap(game, s, filename, &width, &height);
+			Prefetch_Forget(game, filename, width, height);
+		}
+		al_destroy_bitmap(s->frame);
+		al_destroy_bitmap(s->bitmap);
+		s->frame = NULL;
+		s->bitmap = NULL;
+		s->requested = false;
 	}
-	LEVELS(UnloadBitmaps, game);
+	al_destroy_bitmap(game->level.derpy_frames);
+	game->level.derpy_frames = NULL;
+	game->level.derpy = NULL;
+	game->level.descriptor->UnloadBitmaps(game);
 	al_destroy_bitmap(game->level.foreground);
 	al_destroy_bitmap(game->level.background);
 	al_destroy_bitmap(game->level.clouds);
 	al_destroy_bitmap(game->level.stage);
 	al_destroy_bitmap(game->level.meter_bmp);
 	al_destroy_bitmap(game->level.meter_image);
-	al_destroy_bitmap(game->level.welcome);
+	Pool_Release(game, game->level.welcome);
 	game->level.foreground = NULL;
 }
 
 int Level_PreloadSteps(struct Game *game) {
-	switch (game->level.current_level) {
-		case 1:
-			return Level1_PreloadSteps(); break;
-		case 2:
-			return Level2_PreloadSteps(); break;
-		case 3:
-			return Level3_PreloadSteps(); break;
-		case 4:
-			return Level4_PreloadSteps(); break;
-		case 5:
-			return Level5_PreloadSteps(); break;
-		case 6:
-			return Level6_PreloadSteps(); break;
-	}
-	return 0;
+	return game->level.descriptor->PreloadSteps();
 }
 
 void Level_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float)) {
-	int x = 0;
+	int i, x = 0, width, height, frames_width = 1, frames_height = 1;
 
-	struct Spritesheet *tmp = game->level.derpy_sheets;
-	while (tmp) {
-		x++;
-		tmp = tmp->next;
+	/* only current spritesheet is loaded up front, the rest is loaded once timeline gets close to them;
+	   baking needs all of them at once */
+	bool Eager(int handle) {
+		return (game->spritesheets.list[handle].registered) && ((Bake_Active()) || (handle == game->level.sheet));
+	}
+	for (i=0; i<game->spritesheets.count; i++) {
+		if (Eager(i)) x++;
 	}
 
 	PROGRESS_INIT(8+x+Level_PreloadSteps(game));
 
-	tmp = game->level.derpy_sheets;
-	while (tmp) {
-		char filename[255] = { };
-		sprintf(filename, "levels/derpy/%s.png", tmp->name);
-		tmp->bitmap = LoadScaledBitmap(filename, (int)(game->viewportHeight*0.25*tmp->aspect*tmp->scale)*tmp->cols, (int)(game->viewportHeight*0.25*tmp->scale)*tmp->rows);
+	for (i=0; i<game->spritesheets.count; i++) {
+		struct Spritesheet *s = &game->spritesheets.list[i];
+		if (!s->registered) continue;
+		DerpyFrameSize(game, s, &width, &height);
+		if (width > frames_width) frames_width = width;
+		if (height > frames_height) frames_height = height;
+		if (!Eager(i)) continue;
+		LoadDerpySpritesheet(game, s);
 		PROGRESS;
-		tmp = tmp->next;
+	}
+	/* frames of all spritesheets share one bitmap of the largest frame size, so switching them doesn't allocate;
+	   only one is active at a time and it redraws its frame into the shared pixels on every draw */
+	game->level.derpy_frames = al_create_bitmap(frames_width, frames_height);
+	for (i=0; i<game->spritesheets.count; i++) {
+		struct Spritesheet *s = &game->spritesheets.list[i];
+		if (!s->registered) continue;
+		DerpyFrameSize(game, s, &width, &height);
+		s->frame = al_create_sub_bitmap(game->level.derpy_frames, 0, 0, width, height);
 	}
 	PROGRESS;
-	if (!game->level.derpy) SelectDerpySpritesheet(game, "stand");
-
-	game->level.derpy = al_create_bitmap(al_get_bitmap_width(*(game->level.derpy_sheet))/game->level.sheet_cols, al_get_bitmap_height(*(game->level.derpy_sheet))/game->level.sheet_rows);
+	/* keep current animation where it was, so reloading bitmaps doesn't interrupt it */
+	if (game->level.sheet >= 0) game->level.derpy = game->spritesheets.list[game->level.sheet].frame;
 	
-	game->level.clouds = LoadScaledBitmap(GetLevelFilename(game, "levels/?/clouds.png"), game->viewportHeight*4.73307291666666666667, game->viewportHeight);
+	ALLEGRO_BITMAP* LoadLayer(char* filename) {
+		char* name = GetLevelFilename(game, filename);
+		ALLEGRO_BITMAP* bitmap = Prefetch_LoadBitmap(game, name, game->viewportHeight*4.73307291666666666667, game->viewportHeight);
+		free(name);
+		return bitmap;
+	}
+	game->level.clouds = LoadLayer("levels/?/clouds.png");
 	PROGRESS;
-	game->level.foreground = LoadScaledBitmap(GetLevelFilename(game, "levels/?/foreground.png"), game->viewportHeight*4.73307291666666666667, game->viewportHeight);
+	game->level.foreground = LoadLayer("levels/?/foreground.png");
 	PROGRESS;
-	game->level.background = LoadScaledBitmap(GetLevelFilename(game, "levels/?/background.png"), game->viewportHeight*4.73307291666666666667, game->viewportHeight);
+	game->level.background = LoadLayer("levels/?/background.png");
 	PROGRESS;
-	game->level.stage = LoadScaledBitmap(GetLevelFilename(game, "levels/?/stage.png"), game->viewportHeight*4.73307291666666666667, game->viewportHeight);
+	game->level.stage = LoadLayer("levels/?/stage.png");
 	PROGRESS;
-	game->level.meter_image = LoadScaledBitmap("levels/meter.png", game->viewportWidth*0.075, game->viewportWidth*0.075*0.96470588235294117647);
+	game->level.meter_image = Prefetch_LoadBitmap(game, "levels/meter.png", game->viewportWidth*0.075, game->viewportWidth*0.075*0.96470588235294117647);
 	PROGRESS;
 	game->level.meter_bmp = al_create_bitmap(game->viewportWidth*0.2+al_get_bitmap_width(game->level.meter_image), al_get_bitmap_height(game->level.meter_image));
 	PROGRESS;
-	game->level.welcome = al_create_bitmap(game->viewportWidth, game->viewportHeight/2);
+	game->level.welcome = Pool_Acquire(game, game->viewportWidth, game->viewportHeight/2);
 	PROGRESS;
 
 	void ChildProgress(struct Game* game, float p) {
 		if (progress) (*progress)(game, load_p+=1/load_a);
 	}
-	LEVELS(PreloadBitmaps, game, &ChildProgress);
+	game->level.descriptor->PreloadBitmaps(game, &ChildProgress);
+	/* whatever was prefetched for other levels isn't needed anymore */
+	Prefetch_Cancel(game);
 }
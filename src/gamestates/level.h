@@ -20,9 +20,14 @@
  */
 #include "../main.h"
 
-void SelectDerpySpritesheet(struct Game *game, char* name);
-void RegisterDerpySpritesheet(struct Game *game, char* name);
+int FindDerpySpritesheet(struct Game *game, char* name);
+void SelectDerpySpritesheet(struct Game *game, int handle);
+int RegisterDerpySpritesheet(struct Game *game, char* name);
+void FreeDerpySpritesheets(struct Game *game);
+void PrefetchDerpySpritesheet(struct Game *game, char* name);
+void Level_Prefetch(struct Game *game, int level);
 void Level_Passed(struct Game *game);
+void Level_Restart(struct Game *game);
 void Level_Pause(struct Game *game);
 void Level_Resume(struct Game *game);
 void Level_Draw(struct Game *game);
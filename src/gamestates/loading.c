@@ -19,60 +19,55 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 #include <stdio.h>
+#include "../text.h"
+#include "../transition.h"
 #include "loading.h"
 
 void Progress(struct Game *game, float p) {
 	if (game->debug) { printf("%f\n", p); fflush(stdout); }
+	game->loading.progress = p;
+	/* fade in goes on while preloading, advanced by logic ticks elapsed since the previous step */
+	double now = al_get_time();
+	while ((Transition_Active(game)) && (now - game->loading.last >= 1.0/LOGIC_FPS)) {
+		Transition_Logic(game);
+		game->loading.last += 1.0/LOGIC_FPS;
+	}
 	al_set_target_bitmap(al_get_backbuffer(game->display));
-	al_draw_bitmap(game->loading.loading_bitmap,0,0,0);
-	al_draw_filled_rectangle(0, game->viewportHeight*0.985, p*game->viewportWidth, game->viewportHeight, al_map_rgba(255,255,255,255));
+	DrawGameState(game);
 	DrawConsole(game);
 	al_flip_display();
 }
 
 void Loading_Draw(struct Game *game) {
-	float fadeloop=0;
-	while (fadeloop<256) {
-		ALLEGRO_EVENT ev;
-		al_wait_for_event(game->event_queue, &ev);
-		if ((ev.type == ALLEGRO_EVENT_TIMER) && (ev.timer.source == game->timer)) {
-			fadeloop+=10;
-		}
-		if (al_is_event_queue_empty(game->event_queue)) {
-			al_draw_tinted_bitmap(game->loading.loading_bitmap,al_map_rgba_f(fadeloop/255.0,fadeloop/255.0,fadeloop/255.0,1),0,0,0);
-			DrawConsole(game);
-			al_flip_display();
-		}
-	}
-
 	al_draw_bitmap(game->loading.loading_bitmap,0,0,0);
+	if (game->loading.progress > 0) al_draw_filled_rectangle(0, game->viewportHeight*0.985, game->loading.progress*game->viewportWidth, game->viewportHeight, al_map_rgba(255,255,255,255));
+}
 
-	al_stop_timer(game->timer);
-
-	PreloadGameState(game, &Progress);
-
-	al_wait_for_vsync();
-	al_start_timer(game->timer);
-
-	fadeloop=0;
-	while (fadeloop<256) {
-		ALLEGRO_EVENT ev;
-		al_wait_for_event(game->event_queue, &ev);
-		if ((ev.type == ALLEGRO_EVENT_TIMER) && (ev.timer.source == game->timer)) {
-			fadeloop+=10;
-		}
-		if (al_is_event_queue_empty(game->event_queue)) {
-			al_draw_bitmap(game->loading.loading_bitmap,0,0,0);
-			al_draw_filled_rectangle(0, game->viewportHeight*0.985, game->viewportWidth, game->viewportHeight, al_map_rgba(255,255,255,255));
-			al_draw_filled_rectangle(0, 0, game->viewportWidth, game->viewportHeight, al_map_rgba_f(0,0,0,fadeloop/255.0));
-
-			DrawConsole(game);
-			al_flip_display();
-		}
+void Loading_Logic(struct Game *game) {
+	if (!game->loading.started) {
+		/* leaving gamestate has already been unloaded, only its snapshot is crossfaded into loading screen */
+		game->loading.started = true;
+		game->loading.preloaded = false;
+		game->loading.progress = 0;
+		Transition_In(game);
+		return;
 	}
-	al_clear_to_color(al_map_rgb(0,0,0));
-	DrawConsole(game);
-	al_flip_display();
+	if (!game->loading.preloaded) {
+		/* preloading starts right away and blocks, so the fade is driven by its progress steps
+		   instead of logic ticks, which aren't piled up in the meantime */
+		al_stop_timer(game->timer);
+		game->loading.last = al_get_time();
+		PreloadGameState(game, &Progress);
+		game->loading.progress = 1;
+		game->loading.preloaded = true;
+		al_start_timer(game->timer);
+	}
+	/* whatever is left of the fade in is finished by logic ticks */
+	if (Transition_Active(game)) return;
+
+	game->loading.started = false;
+	/* finished loading screen is crossfaded into loaded gamestate */
+	Transition_Out(game);
 	LoadGameState(game);
 }
 
@@ -86,10 +81,13 @@ void Loading_Load(struct Game *game) {
 	al_set_target_bitmap(game->loading.loading_bitmap);
 	al_clear_to_color(al_map_rgb(193,225,218));
 	al_draw_bitmap(game->loading.image, game->viewportWidth-al_get_bitmap_width(game->loading.image), 0, 0);
-	al_draw_text_with_shadow(game->font, al_map_rgb(255,255,255), game->viewportWidth*0.0234, game->viewportHeight*0.84, ALLEGRO_ALIGN_LEFT, "Loading...");
+	Text_DrawWithShadow(game, game->font, al_map_rgb(255,255,255), game->viewportWidth*0.0234, game->viewportHeight*0.84, ALLEGRO_ALIGN_LEFT, "Loading...");
 	al_draw_filled_rectangle(0, game->viewportHeight*0.985, game->viewportWidth, game->viewportHeight, al_map_rgba(128,128,128,128));
 	al_set_target_bitmap(al_get_backbuffer(game->display));
 	al_destroy_bitmap(game->loading.image);
+	game->loading.started = false;
+	game->loading.preloaded = false;
+	game->loading.progress = 0;
 }
 
 int Loading_Keydown(struct Game *game, ALLEGRO_EVENT *ev) { return 0; }
@@ -21,6 +21,7 @@
 #include "../main.h"
 
 void Loading_Draw(struct Game *game);
+void Loading_Logic(struct Game *game);
 void Loading_Preload(struct Game *game, void (*progress)(struct Game*, float));
 void Loading_Unload(struct Game *game);
 void Loading_Load(struct Game *game);
@@ -21,6 +21,11 @@
 #include <stdio.h>
 #include <math.h>
 #include "../config.h"
+#include "../sound.h"
+#include "../assets.h"
+#include "../prefetch.h"
+#include "../pool.h"
+#include "level.h"
 #include "map.h"
 
 void Map_Draw(struct Game *game) {
@@ -60,21 +65,24 @@ void Map_Logic(struct Game *game) {
 }
 
 void Map_Load(struct Game *game) {
-	al_play_sample_instance(game->map.music);
+	al_set_audio_stream_playing(game->map.music, true);
+	/* player is likely to enter highlighted level, so start decoding it while map is shown */
+	Level_Prefetch(game, game->map.selected);
 	FadeGameState(game, true);
 }
 
 int Map_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
+	int selected = game->map.selected;
 	if ((((game->map.selected<4) || (game->map.selected==6)) && (ev->keyboard.keycode==ALLEGRO_KEY_LEFT)) || ((game->map.selected>4) && (game->map.selected!=6) && (ev->keyboard.keycode==ALLEGRO_KEY_RIGHT)) || ((game->map.selected==4) && (ev->keyboard.keycode==ALLEGRO_KEY_UP)) || ((game->map.selected==6) && (ev->keyboard.keycode==ALLEGRO_KEY_DOWN))) {
 		game->map.selected--;
-		al_play_sample_instance(game->map.click);
+		Sound_Play(game->map.click);
 	} else if (((game->map.selected<3) && (ev->keyboard.keycode==ALLEGRO_KEY_RIGHT)) || ((game->map.selected==4) && (ev->keyboard.keycode==ALLEGRO_KEY_LEFT)) || ((game->map.selected==3) && (ev->keyboard.keycode==ALLEGRO_KEY_DOWN)) || ((game->map.selected==5) && (ev->keyboard.keycode==ALLEGRO_KEY_UP))) {
 		game->map.selected++;
-		al_play_sample_instance(game->map.click);
+		Sound_Play(game->map.click);
 	} else if ((ev->keyboard.keycode==ALLEGRO_KEY_LEFT) || (ev->keyboard.keycode==ALLEGRO_KEY_RIGHT) || (ev->keyboard.keycode==ALLEGRO_KEY_UP) || (ev->keyboard.keycode==ALLEGRO_KEY_DOWN)) {
-		al_play_sample_instance(game->map.click);
+		Sound_Play(game->map.click);
 	} else if (ev->keyboard.keycode==ALLEGRO_KEY_ENTER) {
-		al_play_sample_instance(game->map.click);
+		Sound_Play(game->map.click);
 		game->level.input.current_level = game->map.selected;
 		PrintConsole(game, "Selecting level %d...", game->map.selected);
 		UnloadGameState(game);
@@ -82,6 +90,7 @@ int Map_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 		game->loadstate = GAMESTATE_LEVEL;
 		return 0;
 	} else if (ev->keyboard.keycode == ALLEGRO_KEY_ESCAPE) {
+		Prefetch_Cancel(game);
 		UnloadGameState(game);
 		game->loadstate = GAMESTATE_MENU;
 		LoadGameState(game);
@@ -89,53 +98,44 @@ int Map_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 	} else { return 0; }
 	if (game->map.selected<1) game->map.selected=1;
 	if (game->map.selected>game->map.available) game->map.selected=game->map.available;
+	if (game->map.selected != selected) Level_Prefetch(game, game->map.selected);
 	return 0;
 }
 
 void Map_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	PROGRESS_INIT(7);
 
-	game->map.available = atoi(GetConfigOptionDefault("MuffinAttack", "level", "1"));
+	game->map.available = GetConfigInt("MuffinAttack", "level", 1);
 	if ((game->map.available<1) || (game->map.available>6)) game->map.available=1;
 	game->map.selected = game->map.available;
 	PrintConsole(game, "Last level available: %d", game->map.selected);
 	game->map.arrowpos = 0;
 
-	game->map.map_bg = LoadScaledBitmap("map/background.png", game->viewportWidth, game->viewportHeight);
+	game->map.map_bg = Assets_LoadBitmap(game, "map/background.png", game->viewportWidth, game->viewportHeight);
 	PROGRESS;
 	char filename[30] = { };
 	sprintf(filename, "map/highlight%d.png", game->map.available);
-	game->map.highlight = LoadScaledBitmap(filename, game->viewportWidth, game->viewportHeight);
+	game->map.highlight = Assets_LoadBitmap(game, filename, game->viewportWidth, game->viewportHeight);
 	PROGRESS;
 
-	game->map.arrow = al_load_bitmap( GetDataFilePath("map/arrow.png") );
+	char* path = GetDataFilePath("map/arrow.png");
+	game->map.arrow = al_load_bitmap(path);
+	free(path);
 	PROGRESS;
 
-	game->map.click_sample = al_load_sample( GetDataFilePath("menu/click.flac") );
+	game->map.click = Sound_Load(game, "menu/click.flac");
 	PROGRESS;
-	game->map.sample = al_load_sample( GetDataFilePath("map/map.flac") );
+	game->map.music = LoadMusic(game, "map/map.flac");
 	PROGRESS;
 
-	game->map.music = al_create_sample_instance(game->map.sample);
-	al_attach_sample_instance_to_mixer(game->map.music, game->audio.music);
-	al_set_sample_instance_playmode(game->map.music, ALLEGRO_PLAYMODE_LOOP);
-
-	game->map.click = al_create_sample_instance(game->map.click_sample);
-	al_attach_sample_instance_to_mixer(game->map.click, game->audio.fx);
-	al_set_sample_instance_playmode(game->map.click, ALLEGRO_PLAYMODE_ONCE);
-
-	if (!game->map.sample){
-		fprintf(stderr, "Audio clip sample not loaded!\n" );
-		exit(-1);
-	}
-	if (!game->map.click_sample){
-		fprintf(stderr, "Audio clip sample#2 not loaded!\n" );
-		exit(-1);
-	}
-
-	game->map.map = LoadScaledBitmap("table.png", game->viewportWidth, game->viewportHeight);
+	ALLEGRO_BITMAP *table = Assets_LoadBitmap(game, "table.png", game->viewportWidth, game->viewportHeight);
 	PROGRESS;
+	/* shared assets can't be drawn on, so map is composed on its own bitmap */
+	game->map.map = Pool_Acquire(game, game->viewportWidth, game->viewportHeight);
 	al_set_target_bitmap(game->map.map);
+	al_clear_to_color(al_map_rgb(0,0,0));
+	al_draw_bitmap(table, 0, 0 ,0);
+	Assets_Release(game, table);
 	al_draw_bitmap(game->map.map_bg, 0, 0 ,0);
 	al_draw_bitmap(game->map.highlight, 0, 0 ,0);
 	al_set_target_bitmap(al_get_backbuffer(game->display));
@@ -144,12 +144,10 @@ void Map_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 
 void Map_Unload(struct Game *game) {
 	FadeGameState(game, false);
-	al_destroy_bitmap(game->map.map);
-	al_destroy_bitmap(game->map.map_bg);
-	al_destroy_bitmap(game->map.highlight);
+	Pool_Release(game, game->map.map);
+	Assets_Release(game, game->map.map_bg);
+	Assets_Release(game, game->map.highlight);
 	al_destroy_bitmap(game->map.arrow);
-	al_destroy_sample_instance(game->map.music);
-	al_destroy_sample(game->map.sample);
-	al_destroy_sample_instance(game->map.click);
-	al_destroy_sample(game->map.click_sample);
+	al_destroy_audio_stream(game->map.music);
+	Sound_Release(game, game->map.click);
 }
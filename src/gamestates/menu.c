@@ -20,85 +20,88 @@
  */
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
 #include "../config.h"
+#include "../sound.h"
+#include "../font.h"
+#include "../text.h"
 #include "menu.h"
 
+/*! \brief Formats labels of menu items showing values, after the values change. */
+void UpdateMenuLabels(struct Game *game) {
+	if (game->music) snprintf(game->menu.labels[0], sizeof(game->menu.labels[0]), "Music volume: %d0%%", game->music);
+	else snprintf(game->menu.labels[0], sizeof(game->menu.labels[0]), "Music disabled");
+	if (game->fx) snprintf(game->menu.labels[1], sizeof(game->menu.labels[1]), "Effects volume: %d0%%", game->fx);
+	else snprintf(game->menu.labels[1], sizeof(game->menu.labels[1]), "Effects disabled");
+	if (game->voice) snprintf(game->menu.labels[2], sizeof(game->menu.labels[2]), "Voice volume: %d0%%", game->voice);
+	else snprintf(game->menu.labels[2], sizeof(game->menu.labels[2]), "Voice disabled");
+}
+
 void DrawMenuState(struct Game *game) {
 	ALLEGRO_FONT *font;
-	char* text = malloc(255*sizeof(char));
 	struct ALLEGRO_COLOR color;
+	/* all items come from the same atlas, so they're drawn in one pass */
+	al_hold_bitmap_drawing(true);
 	switch (game->menu.menustate) {
 		case MENUSTATE_MAIN:
 			font = game->menu.font; if (game->menu.selected==0) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Start game");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Start game");
 			font = game->menu.font; if (game->menu.selected==1) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Options");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Options");
 			font = game->menu.font; if (game->menu.selected==2) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "About");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "About");
 			font = game->menu.font; if (game->menu.selected==3) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Exit");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Exit");
 			break;
 		case MENUSTATE_OPTIONS:
 			font = game->menu.font; if (game->menu.selected==0) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Control settings");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Control settings");
 			font = game->menu.font; if (game->menu.selected==1) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Video settings");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Video settings");
 			font = game->menu.font; if (game->menu.selected==2) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "Audio settings");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "Audio settings");
 			font = game->menu.font; if (game->menu.selected==3) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Back");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Back");
 			break;
 		case MENUSTATE_AUDIO:
 			font = game->menu.font; if (game->menu.selected==0) font = game->menu.font_selected;
-			if (game->music) sprintf(text, "Music volume: %d0%%", game->music);
-			else sprintf(text, "Music disabled");
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, text);
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, game->menu.labels[0]);
 			font = game->menu.font; if (game->menu.selected==1) font = game->menu.font_selected;
-			if (game->fx) sprintf(text, "Effects volume: %d0%%", game->fx);
-			else sprintf(text, "Effects disabled");
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, text);
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, game->menu.labels[1]);
 			font = game->menu.font; if (game->menu.selected==2) font = game->menu.font_selected;
-			if (game->voice) sprintf(text, "Voice volume: %d0%%", game->voice);
-			else sprintf(text, "Voice disabled");
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, text);
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, game->menu.labels[2]);
 			font = game->menu.font; if (game->menu.selected==3) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Back");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Back");
 			break;
 		case MENUSTATE_VIDEO:
-			if (game->menu.options.fullscreen) {
-				sprintf(text, "Fullscreen: yes");
-				color = al_map_rgba(0,0,0,128);
-			}
-			else {
-				sprintf(text, "Fullscreen: no");
-				color = al_map_rgba(255,255,255,255);
-			}
+			if (game->menu.options.fullscreen) color = al_map_rgba(0,0,0,128);
+			else color = al_map_rgba(255,255,255,255);
 			font = game->menu.font; if (game->menu.selected==0) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, text);
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, game->menu.options.fullscreen ? "Fullscreen: yes" : "Fullscreen: no");
 			font = game->menu.font; if (game->menu.selected==1) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, color, game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Resolution: 800x500");
+			Text_DrawWithShadow(game, font, color, game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Resolution: 800x500");
 			font = game->menu.font; if (game->menu.selected==2) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "FPS: 60");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "FPS: 60");
 			font = game->menu.font; if (game->menu.selected==3) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Back");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Back");
 			break;
 		case MENUSTATE_PAUSE:
 			font = game->menu.font; if (game->menu.selected==0) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Resume game");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Resume game");
 			font = game->menu.font; if (game->menu.selected==1) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Return to map");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.6, ALLEGRO_ALIGN_CENTRE, "Return to map");
 			font = game->menu.font; if (game->menu.selected==2) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "Options");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.7, ALLEGRO_ALIGN_CENTRE, "Options");
 			font = game->menu.font; if (game->menu.selected==3) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Exit");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.8, ALLEGRO_ALIGN_CENTRE, "Exit");
 			break;
 		default:
 			game->menu.selected=0;
 			font = game->menu.font; if (game->menu.selected==0) font = game->menu.font_selected;
-			al_draw_text_with_shadow(font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Not implemented yet");
+			Text_DrawWithShadow(game, font, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.5, ALLEGRO_ALIGN_CENTRE, "Not implemented yet");
 			break;
 	}
-	free(text);
+	al_hold_bitmap_drawing(false);
 }
 
 void Menu_Draw(struct Game *game) {
@@ -121,7 +124,7 @@ void Menu_Draw(struct Game *game) {
 
 	al_clear_to_color(al_map_rgb(183,234,193));
 	float tint = (sin((game->menu.cloud_position-80)/15)+1)/2;
-	if (tint < 0.000004) { PrintConsole(game, "random tint %f", tint); game->menu.mountain_position = (game->viewportWidth*(rand()/(float)RAND_MAX)/2)+game->viewportWidth/2; }
+	if (tint < 0.000004) { PrintConsole(game, "random tint %f", tint); game->menu.mountain_position = (game->viewportWidth*RNG_Float(&game->menu.rng)/2)+game->viewportWidth/2; }
 	al_draw_tinted_bitmap(game->menu.mountain,al_map_rgba_f(tint,tint,tint,tint),game->menu.mountain_position, 0,0);
 	al_draw_scaled_bitmap(game->menu.cloud,0,0,al_get_bitmap_width(game->menu.cloud), al_get_bitmap_height(game->menu.cloud), game->viewportWidth*(sin((game->menu.cloud_position/40)-4.5)-0.3), game->viewportHeight*0.35, al_get_bitmap_width(game->menu.cloud)/2, al_get_bitmap_height(game->menu.cloud)/2,0);
 	al_draw_bitmap(game->menu.cloud2,game->viewportWidth*(game->menu.cloud2_position/100.0), game->viewportHeight-(game->viewportWidth*(1240.0/3910.0))*0.7,0);
@@ -166,8 +169,8 @@ void Menu_Draw(struct Game *game) {
 	al_draw_tinted_bitmap(game->menu.logo, al_map_rgba_f(0.1, 0.1, 0.1, 0.1), (game->viewportWidth/2)-(al_get_bitmap_width(game->menu.logo)/2), (game->viewportHeight*0.1), 0);
 	/* END OF GLASS EFFECT */
 
-	al_draw_text_with_shadow(game->menu.font_title, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.1, ALLEGRO_ALIGN_CENTRE, "Super Derpy");
-	al_draw_text_with_shadow(game->menu.font_subtitle, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.275, ALLEGRO_ALIGN_CENTRE, "Muffin Attack");
+	Text_DrawWithShadow(game, game->menu.font_title, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.1, ALLEGRO_ALIGN_CENTRE, "Super Derpy");
+	Text_DrawWithShadow(game, game->menu.font_subtitle, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.275, ALLEGRO_ALIGN_CENTRE, "Muffin Attack");
 
 	DrawMenuState(game);
 }
@@ -186,6 +189,7 @@ void Menu_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	game->menu.options.fps = game->fps;
 	game->menu.options.width = game->width;
 	game->menu.options.height = game->height;
+	UpdateMenuLabels(game);
 	game->menu.loaded = true;
 	game->menu.image = LoadScaledBitmap( "menu/menu.png", game->viewportWidth, game->viewportWidth*(1240.0/3910.0));
 	PROGRESS;
@@ -219,53 +223,35 @@ void Menu_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 	game->menu.pinkcloud = LoadScaledBitmap( "menu/pinkcloud.png", game->viewportHeight*0.8122*(1171.0/2218.0), game->viewportHeight*0.8122);
 	PROGRESS;
 	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
-	game->menu.rain = al_load_bitmap( GetDataFilePath("menu/rain.png") );
+	char* path = GetDataFilePath("menu/rain.png");
+	game->menu.rain = al_load_bitmap(path);
+	free(path);
 	PROGRESS;
-	game->menu.pie = al_load_bitmap( GetDataFilePath("menu/pie.png") );
+	path = GetDataFilePath("menu/pie.png");
+	game->menu.pie = al_load_bitmap(path);
+	free(path);
 	al_set_new_bitmap_flags(ALLEGRO_MAG_LINEAR | ALLEGRO_MIN_LINEAR);
 	PROGRESS;
 
-	game->menu.sample = al_load_sample( GetDataFilePath("menu/menu.flac") );
+	game->menu.music = LoadMusic(game, "menu/menu.flac");
 	PROGRESS;
-	game->menu.rain_sample = al_load_sample( GetDataFilePath("menu/rain.flac") );
+	game->menu.rain_sample = Sound_Load(game, "menu/rain.flac");
 	PROGRESS;
-	game->menu.click_sample = al_load_sample( GetDataFilePath("menu/click.flac") );
+	game->menu.click = Sound_Load(game, "menu/click.flac");
 	PROGRESS;
 	game->menu.mountain_position = game->viewportWidth*0.7;
+	RNG_Seed(&game->menu.rng, time(NULL), RNG_STREAM_MENU);
 
-	game->menu.music = al_create_sample_instance(game->menu.sample);
-	al_attach_sample_instance_to_mixer(game->menu.music, game->audio.music);
-	al_set_sample_instance_playmode(game->menu.music, ALLEGRO_PLAYMODE_LOOP);
-
-	game->menu.rain_sound = al_create_sample_instance(game->menu.rain_sample);
+	game->menu.rain_sound = al_create_sample_instance(game->menu.rain_sample->sample);
 	al_attach_sample_instance_to_mixer(game->menu.rain_sound, game->audio.fx);
 	al_set_sample_instance_playmode(game->menu.rain_sound, ALLEGRO_PLAYMODE_LOOP);
 
-	game->menu.click = al_create_sample_instance(game->menu.click_sample);
-	al_attach_sample_instance_to_mixer(game->menu.click, game->audio.fx);
-	al_set_sample_instance_playmode(game->menu.click, ALLEGRO_PLAYMODE_ONCE);
-
-	game->menu.font_title = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.16,0 );
-	game->menu.font_subtitle = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.08,0 );
-	game->menu.font = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.05,0 );
-	game->menu.font_selected = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.065,0 );
+	game->menu.font_title = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.16);
+	game->menu.font_subtitle = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.08);
+	game->menu.font = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.05);
+	game->menu.font_selected = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.065);
 	PROGRESS;
 
-	if (!game->menu.sample){
-		fprintf(stderr, "Audio clip sample not loaded!\n" );
-		exit(-1);
-	}
-
-	if (!game->menu.rain_sample){
-		fprintf(stderr, "Audio clip sample#2 not loaded!\n" );
-		exit(-1);
-	}
-
-	if (!game->menu.click_sample){
-		fprintf(stderr, "Audio clip sample#3 not loaded!\n" );
-		exit(-1);
-	}
-
 	game->menu.pinkcloud_bitmap = al_create_bitmap(game->viewportHeight*0.8122*(1171.0/2218.0), game->viewportHeight);
 
 	game->menu.pie_bitmap = al_create_bitmap(game->viewportHeight*0.8, game->viewportHeight);
@@ -289,7 +275,7 @@ void Menu_Preload(struct Game *game, void (*progress)(struct Game*, float)) {
 
 void Menu_Stop(struct Game* game) {
 	FadeGameState(game, false);
-	al_stop_sample_instance(game->menu.music);
+	StopMusic(game->menu.music);
 	al_stop_sample_instance(game->menu.rain_sound);
 }
 
@@ -315,16 +301,10 @@ void Menu_Unload(struct Game *game) {
 	al_destroy_bitmap(game->menu.glass);
 	al_destroy_bitmap(game->menu.blurbg);
 	al_destroy_bitmap(game->menu.blurbg2);
-	al_destroy_font(game->menu.font_title);
-	al_destroy_font(game->menu.font_subtitle);
-	al_destroy_font(game->menu.font);
-	al_destroy_font(game->menu.font_selected);
-	al_destroy_sample_instance(game->menu.music);
+	al_destroy_audio_stream(game->menu.music);
 	al_destroy_sample_instance(game->menu.rain_sound);
-	al_destroy_sample_instance(game->menu.click);
-	al_destroy_sample(game->menu.sample);
-	al_destroy_sample(game->menu.rain_sample);
-	al_destroy_sample(game->menu.click_sample);
+	Sound_Release(game, game->menu.rain_sample);
+	Sound_Release(game, game->menu.click);
 	game->menu.loaded = false;
 }
 
@@ -335,7 +315,7 @@ void Menu_Load(struct Game *game) {
 	game->menu.cloud2_position = 100;
 	ChangeMenuState(game,MENUSTATE_MAIN);
 
-	al_play_sample_instance(game->menu.music);
+	al_set_audio_stream_playing(game->menu.music, true);
 	al_play_sample_instance(game->menu.rain_sound);
 	FadeGameState(game, true);
 }
@@ -345,16 +325,15 @@ int Menu_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 	if (ev->keyboard.keycode==ALLEGRO_KEY_UP) {
 		game->menu.selected--;
 		if ((game->menu.menustate==MENUSTATE_VIDEO) && (game->menu.selected==1) && (game->menu.options.fullscreen)) game->menu.selected--;
-		al_play_sample_instance(game->menu.click);
+		Sound_Play(game->menu.click);
 	} else if (ev->keyboard.keycode==ALLEGRO_KEY_DOWN) {
 		game->menu.selected++;
 		if ((game->menu.menustate==MENUSTATE_VIDEO) && (game->menu.selected==1) && (game->menu.options.fullscreen)) game->menu.selected++;
-		al_play_sample_instance(game->menu.click);
+		Sound_Play(game->menu.click);
 	}
 
 	if (ev->keyboard.keycode==ALLEGRO_KEY_ENTER) {
-		char *text;
-		al_play_sample_instance(game->menu.click);
+		Sound_Play(game->menu.click);
 		switch (game->menu.menustate) {
 			case MENUSTATE_MAIN:
 				switch (game->menu.selected) {
@@ -377,34 +356,28 @@ int Menu_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 				}
 				break;
 			case MENUSTATE_AUDIO:
-				text = malloc(255*sizeof(char));
+				/* mixers follow volume entries by themselves */
 				switch (game->menu.selected) {
 					case 0:
 						game->music--;
 						if (game->music<0) game->music=10;
-						sprintf(text, "%d", game->music);
-						SetConfigOption("SuperDerpy", "music", text);
-						al_set_mixer_gain(game->audio.music, game->music/10.0);
+						SetConfigInt("SuperDerpy", "music", game->music);
 						break;
 					case 1:
 						game->fx--;
 						if (game->fx<0) game->fx=10;
-						sprintf(text, "%d", game->fx);
-						SetConfigOption("SuperDerpy", "fx", text);
-						al_set_mixer_gain(game->audio.fx, game->fx/10.0);
+						SetConfigInt("SuperDerpy", "fx", game->fx);
 						break;
 					case 2:
 						game->voice--;
 						if (game->voice<0) game->voice=10;
-						sprintf(text, "%d", game->voice);
-						SetConfigOption("SuperDerpy", "voice", text);
-						al_set_mixer_gain(game->audio.voice, game->voice/10.0);
+						SetConfigInt("SuperDerpy", "voice", game->voice);
 						break;
 					case 3:
 						ChangeMenuState(game,MENUSTATE_OPTIONS);
 						break;
 				}
-				free(text);
+				UpdateMenuLabels(game);
 				break;
 			case MENUSTATE_OPTIONS:
 				switch (game->menu.selected) {
@@ -428,13 +401,9 @@ int Menu_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 				switch (game->menu.selected){
 					case 0:
 						PrintConsole(game,"Game resumed.");
-						al_destroy_bitmap(game->pause.bitmap);
-						game->pause.bitmap = NULL;
-						ResumeGameState(game);
-						game->gamestate = game->loadstate;
+						PopGameState(game);
 						break;
 					case 1:
-						game->gamestate=game->loadstate;
 						UnloadGameState(game);
 						game->gamestate = GAMESTATE_LOADING;
 						game->loadstate = GAMESTATE_MAP;
@@ -461,10 +430,7 @@ int Menu_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 				switch (game->menu.selected) {
 					case 0:
 						game->menu.options.fullscreen = !game->menu.options.fullscreen;
-						if (game->menu.options.fullscreen)
-							SetConfigOption("SuperDerpy", "fullscreen", "1");
-						else
-							SetConfigOption("SuperDerpy", "fullscreen", "0");
+						SetConfigInt("SuperDerpy", "fullscreen", game->menu.options.fullscreen);
 						break;
 					case 3:
 						if ((game->menu.options.fullscreen==game->fullscreen) && (game->menu.options.fps==game->fps) && (game->menu.options.width==game->width) && (game->menu.options.height==game->height)) {
@@ -499,10 +465,7 @@ int Menu_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
 				break;
 			case MENUSTATE_PAUSE:
 				PrintConsole(game,"Game resumed.");
-				al_destroy_bitmap(game->pause.bitmap);
-				game->pause.bitmap = NULL;
-				ResumeGameState(game);
-				game->gamestate = game->loadstate;
+				PopGameState(game);
 				break;
 			default:
 				return 1;
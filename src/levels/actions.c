@@ -20,12 +20,13 @@
  */
 
 #include "actions.h"
+#include "../text.h"
 #include "../gamestates/level.h"
 
 bool LevelFailed(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
 	if (state == TM_ACTIONSTATE_DRAW) {
 		al_draw_filled_rectangle(0, 0, game->viewportWidth, game->viewportHeight, al_map_rgba(0,0,0,100));
-		al_draw_text_with_shadow(game->menu.font_title, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.4, ALLEGRO_ALIGN_CENTRE, "Failed!");
+		Text_DrawWithShadow(game, game->menu.font_title, al_map_rgb(255,255,255), game->viewportWidth*0.5, game->viewportHeight*0.4, ALLEGRO_ALIGN_CENTRE, "Failed!");
 	} else if (state == TM_ACTIONSTATE_RUNNING) {
 		// FIXME: this should be more generic. Some callback function?
 		game->level.speed-=0.00001;
@@ -33,6 +34,11 @@ bool LevelFailed(struct Game *game, struct TM_Action *action, enum TM_ActionStat
 			return true;
 		}
 	} else if (state == TM_ACTIONSTATE_DESTROY) {
+		/* simulated and replayed runs cover a single attempt, so they end here */
+		if ((game->display) && (!game->replay)) {
+			game->level.retry = true;
+			return false;
+		}
 		Level_Unload(game);
 		game->gamestate = GAMESTATE_LOADING;
 		game->loadstate = GAMESTATE_MAP;
@@ -51,37 +57,31 @@ bool ShowMeter(struct Game *game, struct TM_Action *action, enum TM_ActionState
 }
 
 bool Stop(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
+	if (state == TM_ACTIONSTATE_INIT) action->spritesheet = game->level.sheet_stand;
 	if (state != TM_ACTIONSTATE_RUNNING) return false;
 	game->level.speed=0;
-	SelectDerpySpritesheet(game, "stand");
+	SelectDerpySpritesheet(game, game->level.sheet_stand);
 	return true;
 }
 
 bool FadeIn(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
 	if (!action->arguments) {
 		action->arguments = TM_AddToArgs(action->arguments, malloc(sizeof(float)));
-		action->arguments = TM_AddToArgs(action->arguments, (void*)al_create_bitmap(game->viewportWidth, game->viewportHeight));
 	}
 	float* fadeloop;
-	ALLEGRO_BITMAP* fade_bitmap;
 	fadeloop = (float*)action->arguments->value;
-	fade_bitmap = (ALLEGRO_BITMAP*)action->arguments->next->value;
 	if (state == TM_ACTIONSTATE_INIT) {
 		*fadeloop = 255;
-		al_set_target_bitmap(fade_bitmap);
-		al_clear_to_color(al_map_rgb(0,0,0));
-		al_set_target_bitmap(al_get_backbuffer(game->display));
 	} else if (state == TM_ACTIONSTATE_RUNNING) {
 		*fadeloop-=10;
 		if (*fadeloop<=0) return true;
 	} else if (state == TM_ACTIONSTATE_DRAW) {
-		al_draw_tinted_bitmap(fade_bitmap,al_map_rgba_f(1,1,1,*fadeloop/255.0),0,0,0);
+		al_draw_filled_rectangle(0, 0, game->viewportWidth, game->viewportHeight, al_map_rgba_f(0,0,0,*fadeloop/255.0));
 	} else if (state == TM_ACTIONSTATE_DESTROY) {
-		al_destroy_bitmap(fade_bitmap);
 		free(fadeloop);
 		TM_DestroyArgs(action->arguments);
 		action->arguments = NULL;
-		al_play_sample_instance(game->level.music);
+		if (game->level.music) al_set_audio_stream_playing(game->level.music, true);
 	}
 	return false;
 }
@@ -89,25 +89,18 @@ bool FadeIn(struct Game *game, struct TM_Action *action, enum TM_ActionState sta
 bool FadeOut(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
 	if (!action->arguments) {
 		action->arguments = TM_AddToArgs(action->arguments, malloc(sizeof(float)));
-		action->arguments = TM_AddToArgs(action->arguments, (void*)al_create_bitmap(game->viewportWidth, game->viewportHeight));
 	}
 	float* fadeloop;
-	ALLEGRO_BITMAP* fade_bitmap;
 	fadeloop = (float*)action->arguments->value;
-	fade_bitmap = (ALLEGRO_BITMAP*)action->arguments->next->value;
 	if (state == TM_ACTIONSTATE_INIT) {
 		*fadeloop = 0;
-		al_set_target_bitmap(fade_bitmap);
-		al_clear_to_color(al_map_rgb(0,0,0));
-		al_set_target_bitmap(al_get_backbuffer(game->display));
 	} else if (state == TM_ACTIONSTATE_RUNNING) {
 		*fadeloop+=10;
 		if (*fadeloop>=256) return true;
 	} else if (state == TM_ACTIONSTATE_DRAW) {
-		al_draw_tinted_bitmap(fade_bitmap,al_map_rgba_f(1,1,1,*fadeloop/255.0),0,0,0);
+		al_draw_filled_rectangle(0, 0, game->viewportWidth, game->viewportHeight, al_map_rgba_f(0,0,0,*fadeloop/255.0));
 	} else if (state == TM_ACTIONSTATE_DESTROY) {
 		PrintConsole(game, "Leaving level with %d HP", (int)(game->level.hp*100));
-		al_destroy_bitmap(fade_bitmap);
 		free(fadeloop);
 		Level_Unload(game);
 		game->gamestate = GAMESTATE_LOADING;
@@ -173,17 +166,26 @@ bool Letter(struct Game *game, struct TM_Action *action, enum TM_ActionState sta
 		float* f = (float*)malloc(sizeof(float));
 		*f = 0;
 		ALLEGRO_AUDIO_STREAM** stream = (ALLEGRO_AUDIO_STREAM**)malloc(sizeof(ALLEGRO_AUDIO_STREAM*));
-		*stream = al_load_audio_stream(GetDataFilePath(GetLevelFilename(game, "levels/?/letter.flac")), 4, 1024);
-		al_attach_audio_stream_to_mixer(*stream, game->audio.voice);
-		al_set_audio_stream_playing(*stream, false);
-		al_set_audio_stream_gain(*stream, 2.00);
+		*stream = NULL;
+		if (game->display) {
+			char* filename = GetLevelFilename(game, "levels/?/letter.flac");
+			char* path = GetDataFilePath(filename);
+			*stream = al_load_audio_stream(path, 4, 1024);
+			free(path);
+			free(filename);
+			al_attach_audio_stream_to_mixer(*stream, game->audio.voice);
+			al_set_audio_stream_playing(*stream, false);
+			al_set_audio_stream_gain(*stream, 2.00);
+		}
 		action->arguments = TM_AddToArgs(action->arguments, (void*)f);
 		action->arguments = TM_AddToArgs(action->arguments, (void*)stream);
 		action->arguments->next->next = NULL;
 	} else if (state == TM_ACTIONSTATE_DESTROY) {
 		ALLEGRO_AUDIO_STREAM** stream = (ALLEGRO_AUDIO_STREAM**)action->arguments->next->value;
-		al_set_audio_stream_playing(*stream, false);
-		al_destroy_audio_stream(*stream);
+		if (*stream) {
+			al_set_audio_stream_playing(*stream, false);
+			al_destroy_audio_stream(*stream);
+		}
 		free(action->arguments->next->value);
 		free(action->arguments->value);
 		TM_DestroyArgs(action->arguments);
@@ -193,21 +195,17 @@ bool Letter(struct Game *game, struct TM_Action *action, enum TM_ActionState sta
 		return false;
 	} else if (state == TM_ACTIONSTATE_PAUSE) {
 		ALLEGRO_AUDIO_STREAM** stream = (ALLEGRO_AUDIO_STREAM**)action->arguments->next->value;
-		al_set_audio_stream_playing(*stream, false);
+		if (*stream) al_set_audio_stream_playing(*stream, false);
 	}	else if ((state == TM_ACTIONSTATE_RESUME) || (state == TM_ACTIONSTATE_START)) {
 		ALLEGRO_AUDIO_STREAM** stream = (ALLEGRO_AUDIO_STREAM**)action->arguments->next->value;
-		al_set_audio_stream_playing(*stream, true);
+		if (*stream) al_set_audio_stream_playing(*stream, true);
 	}
 	if (state != TM_ACTIONSTATE_RUNNING) return false;
 
 	float* f = (float*)action->arguments->value;
 	*f+=5;
 	if (*f>255) *f=255;
-	al_draw_tinted_bitmap(game->level.letter, al_map_rgba(*f,*f,*f,*f), (game->viewportWidth-al_get_bitmap_width(game->level.letter))/2.0, al_get_bitmap_height(game->level.letter)*-0.05, 0);
-	struct ALLEGRO_KEYBOARD_STATE keyboard;
-	al_get_keyboard_state(&keyboard);
-	// FIXME: do it the proper way
-	if (al_key_down(&keyboard, ALLEGRO_KEY_ENTER)) {
+	if (game->level.keys & INPUT_ENTER) {
 		return true;
 	}
 	return false;
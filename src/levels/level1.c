@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 #include <stdio.h>
+#include "../font.h"
+#include "../prefetch.h"
 #include "../gamestates/level.h"
 #include "actions.h"
 #include "modules/dodger.h"
@@ -84,7 +86,6 @@ void Level1_Unload(struct Game *game) {
 
 void Level1_UnloadBitmaps(struct Game *game) {
 	Dodger_UnloadBitmaps(game);
-	al_destroy_font(game->level.letter_font);
 	al_destroy_bitmap(game->level.letter);
 	al_destroy_bitmap(game->level.level1.owl);
 }
@@ -93,17 +94,32 @@ void Level1_Preload(struct Game *game) {
 	Dodger_Preload(game);
 }
 
+void Level1_Prefetch(struct Game *game) {
+	Prefetch_Bitmap(game, "levels/1/owl.png", game->viewportWidth*0.08, game->viewportWidth*0.08);
+	Prefetch_Bitmap(game, "levels/1/letter.png", game->viewportHeight*1.3, game->viewportHeight*1.2);
+	Dodger_Prefetch(game);
+}
+
 inline int Level1_PreloadSteps(void) {
 	return 4+Dodger_PreloadSteps();
 }
 
 void Level1_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float)) {
 	PROGRESS_INIT(Level1_PreloadSteps());
-	game->level.level1.owl = LoadScaledBitmap("levels/1/owl.png", game->viewportWidth*0.08, game->viewportWidth*0.08);
+	game->level.level1.owl = Prefetch_LoadBitmap(game, "levels/1/owl.png", game->viewportWidth*0.08, game->viewportWidth*0.08);
 	PROGRESS;
-	game->level.letter_font = al_load_ttf_font(GetDataFilePath("fonts/DejaVuSans.ttf"),game->viewportHeight*0.0225,0 );
+	game->level.letter_font = NULL;
+	game->level.letter = Prefetch_LoadBitmap(game, "levels/1/letter.png", game->viewportHeight*1.3, game->viewportHeight*1.2);
+	/* texts are rendered only when there's a display to show them on */
+	if (!game->display) {
+		PROGRESS;
+		PROGRESS;
+		PROGRESS;
+		Dodger_PreloadBitmaps(game, progress);
+		return;
+	}
+	game->level.letter_font = Font_Load(game, "fonts/DejaVuSans.ttf", game->viewportHeight*0.0225);
 	PROGRESS;
-	game->level.letter = LoadScaledBitmap("levels/1/letter.png", game->viewportHeight*1.3, game->viewportHeight*1.2);
 	al_set_target_bitmap(game->level.letter);
 	float y = 0.20;
 	float x = 0.19;
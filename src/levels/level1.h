@@ -25,6 +25,7 @@ void Level1_Unload(struct Game *game);
 void Level1_UnloadBitmaps(struct Game *game);
 void Level1_Preload(struct Game *game);
 void Level1_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float));
+void Level1_Prefetch(struct Game *game);
 inline int Level1_PreloadSteps(void);
 void Level1_Draw(struct Game *game);
 void Level1_Logic(struct Game *game);
@@ -53,6 +53,10 @@ void Level2_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, flo
 	Moonwalk_PreloadBitmaps(game, progress);
 }
 
+void Level2_Prefetch(struct Game *game) {
+	Moonwalk_Prefetch(game);
+}
+
 void Level2_Draw(struct Game *game) {
 	Moonwalk_Draw(game);
 }
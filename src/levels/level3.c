@@ -54,6 +54,10 @@ void Level3_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, flo
 	Moonwalk_PreloadBitmaps(game, progress);
 }
 
+void Level3_Prefetch(struct Game *game) {
+	Moonwalk_Prefetch(game);
+}
+
 void Level3_Draw(struct Game *game) {
 	Moonwalk_Draw(game);
 }
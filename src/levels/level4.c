@@ -54,6 +54,10 @@ void Level4_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, flo
 	Moonwalk_PreloadBitmaps(game, progress);
 }
 
+void Level4_Prefetch(struct Game *game) {
+	Moonwalk_Prefetch(game);
+}
+
 void Level4_Draw(struct Game *game) {
 	Moonwalk_Draw(game);
 }
@@ -54,6 +54,10 @@ void Level5_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, flo
 	Moonwalk_PreloadBitmaps(game, progress);
 }
 
+void Level5_Prefetch(struct Game *game) {
+	Moonwalk_Prefetch(game);
+}
+
 void Level5_Draw(struct Game *game) {
 	Moonwalk_Draw(game);
 }
@@ -25,6 +25,7 @@ void Level5_Unload(struct Game *game);
 void Level5_UnloadBitmaps(struct Game *game);
 void Level5_Preload(struct Game *game);
 void Level5_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float));
+void Level5_Prefetch(struct Game *game);
 inline int Level5_PreloadSteps(void);
 void Level5_Draw(struct Game *game);
 void Level5_Logic(struct Game *game);
@@ -54,6 +54,10 @@ void Level6_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, flo
 	Moonwalk_PreloadBitmaps(game, progress);
 }
 
+void Level6_Prefetch(struct Game *game) {
+	Moonwalk_Prefetch(game);
+}
+
 void Level6_Draw(struct Game *game) {
 	Moonwalk_Draw(game);
 }
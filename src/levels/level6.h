@@ -25,6 +25,7 @@ void Level6_Unload(struct Game *game);
 void Level6_UnloadBitmaps(struct Game *game);
 void Level6_Preload(struct Game *game);
 void Level6_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float));
+void Level6_Prefetch(struct Game *game);
 inline int Level6_PreloadSteps(void);
 void Level6_Draw(struct Game *game);
 void Level6_Logic(struct Game *game);
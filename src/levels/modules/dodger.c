@@ -22,22 +22,47 @@
 #include <math.h>
 #include "../../gamestates/level.h"
 #include "../actions.h"
+#include "../../prefetch.h"
 #include "dodger.h"
 #include "dodger/actions.h"
 
+/*! \brief Frees obstacle together with its callback data. */
+void DestroyObstacle(struct Obstacle *obstacle) {
+	free(obstacle->data);
+	free(obstacle);
+}
+
 void Dodger_Logic(struct Game *game) {
-	struct ALLEGRO_KEYBOARD_STATE keyboard;
-	al_get_keyboard_state(&keyboard);
+	unsigned char keys = game->level.keys;
+	unsigned char pressed = keys & ~game->level.keys_prev;
+	unsigned char released = ~keys & game->level.keys_prev;
 	if (game->level.handle_input) {
+		if (pressed & INPUT_LEFT) {
+			game->level.speed_modifier = 0.75;
+		} else if (pressed & INPUT_RIGHT) {
+			game->level.speed_modifier = 1.3;
+		}
+		if (released & INPUT_LEFT) {
+			game->level.speed_modifier = 1;
+			if (keys & INPUT_RIGHT) {
+				game->level.speed_modifier = 1.3;
+			}
+		} else if (released & INPUT_RIGHT) {
+			game->level.speed_modifier = 1;
+			if (keys & INPUT_LEFT) {
+				game->level.speed_modifier = 0.75;
+			}
+		}
+
 		if (game->level.derpy_angle > 0) { game->level.derpy_angle -= 0.02; if (game->level.derpy_angle < 0) game->level.derpy_angle = 0; }
 		if (game->level.derpy_angle < 0) { game->level.derpy_angle += 0.02; if (game->level.derpy_angle > 0) game->level.derpy_angle = 0; }
-		if (al_key_down(&keyboard, ALLEGRO_KEY_UP)) {
+		if (keys & INPUT_UP) {
 			game->level.derpy_y -= 0.005;
 			game->level.derpy_angle -= 0.03;
 			if (game->level.derpy_angle < -0.15) game->level.derpy_angle = -0.15;
 			/*PrintConsole(game, "Derpy Y position: %f", game->level.derpy_y);*/
 		}
-		if (al_key_down(&keyboard, ALLEGRO_KEY_DOWN)) {
+		if (keys & INPUT_DOWN) {
 			game->level.derpy_y += 0.005;
 			game->level.derpy_angle += 0.03;
 			if (game->level.derpy_angle > 0.15) game->level.derpy_angle = 0.15;
@@ -115,7 +140,7 @@ void Dodger_Logic(struct Game *game) {
 				game->level.dodger.obstacles = tmp->next;
 			struct Obstacle *t = tmp;
 			tmp = tmp->next;
-			free(t);
+			DestroyObstacle(t);
 		}
 	}
 	/*if (colision) game->level.hp-=tps(game, 60*0.002);*/
@@ -163,7 +188,7 @@ void Dodger_Draw(struct Game *game) {
 				game->level.dodger.obstacles = tmp->next;
 			struct Obstacle *t = tmp;
 			tmp = tmp->next;
-			free(t);
+			DestroyObstacle(t);
 		}
 	}
 	/*if (colision) game->level.hp-=tps(game, 60*0.002);*/
@@ -188,35 +213,10 @@ void Dodger_Load(struct Game *game) {
 	game->level.dodger.obstacles = NULL;
 }
 
-void Dodger_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {
-	if (game->level.handle_input) {
-		if (ev->keyboard.keycode==ALLEGRO_KEY_LEFT) {
-			game->level.speed_modifier = 0.75;
-		} else if (ev->keyboard.keycode==ALLEGRO_KEY_RIGHT) {
-			game->level.speed_modifier = 1.3;
-		}
-	}
-}
-
-void Dodger_ProcessEvent(struct Game *game, ALLEGRO_EVENT *ev) {
-	if (game->level.handle_input) {
-		if ((ev->type==ALLEGRO_EVENT_KEY_UP) && (ev->keyboard.keycode==ALLEGRO_KEY_LEFT)) {
-			game->level.speed_modifier = 1;
-			struct ALLEGRO_KEYBOARD_STATE keyboard;
-			al_get_keyboard_state(&keyboard);
-			if (al_key_down(&keyboard, ALLEGRO_KEY_RIGHT)) {
-				game->level.speed_modifier = 1.3;
-			}
-		} else if ((ev->type==ALLEGRO_EVENT_KEY_UP) && (ev->keyboard.keycode==ALLEGRO_KEY_RIGHT)) {
-			game->level.speed_modifier = 1;
-			struct ALLEGRO_KEYBOARD_STATE keyboard;
-			al_get_keyboard_state(&keyboard);
-			if (al_key_down(&keyboard, ALLEGRO_KEY_LEFT)) {
-				game->level.speed_modifier = 0.75;
-			}
-		}
-	}
-}
+/* Input is sampled once per logic tick and handled in Dodger_Logic,
+ * so it can be recorded and played back. */
+void Dodger_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {}
+void Dodger_ProcessEvent(struct Game *game, ALLEGRO_EVENT *ev) {}
 
 inline int Dodger_PreloadSteps(void) {
 	return 7;
@@ -224,27 +224,37 @@ inline int Dodger_PreloadSteps(void) {
 
 void Dodger_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float)) {
 	PROGRESS_INIT(Dodger_PreloadSteps());
-	game->level.dodger.obst_bmps.pie1 = LoadScaledBitmap("levels/dodger/pie1.png", game->viewportWidth*0.1, game->viewportHeight*0.08);
+	game->level.dodger.obst_bmps.pie1 = Prefetch_LoadBitmap(game, "levels/dodger/pie1.png", game->viewportWidth*0.1, game->viewportHeight*0.08);
 	PROGRESS;
-	game->level.dodger.obst_bmps.pie2 = LoadScaledBitmap("levels/dodger/pie2.png", game->viewportWidth*0.1, game->viewportHeight*0.08);
+	game->level.dodger.obst_bmps.pie2 = Prefetch_LoadBitmap(game, "levels/dodger/pie2.png", game->viewportWidth*0.1, game->viewportHeight*0.08);
 	PROGRESS;
-	game->level.dodger.obst_bmps.pig = LoadScaledBitmap("levels/dodger/pig.png", (int)(game->viewportWidth*0.15)*3, (int)(game->viewportHeight*0.2)*3);
+	game->level.dodger.obst_bmps.pig = Prefetch_LoadBitmap(game, "levels/dodger/pig.png", (int)(game->viewportWidth*0.15)*3, (int)(game->viewportHeight*0.2)*3);
 	PROGRESS;
-	game->level.dodger.obst_bmps.screwball = LoadScaledBitmap("levels/dodger/screwball.png", (int)(game->viewportHeight*0.2)*4*1.4, (int)(game->viewportHeight*0.2)*4);
+	game->level.dodger.obst_bmps.screwball = Prefetch_LoadBitmap(game, "levels/dodger/screwball.png", (int)(game->viewportHeight*0.2)*4*1.4, (int)(game->viewportHeight*0.2)*4);
 	PROGRESS;
-	game->level.dodger.obst_bmps.muffin = LoadScaledBitmap("levels/dodger/muffin.png", game->viewportWidth*0.07, game->viewportHeight*0.1);
+	game->level.dodger.obst_bmps.muffin = Prefetch_LoadBitmap(game, "levels/dodger/muffin.png", game->viewportWidth*0.07, game->viewportHeight*0.1);
 	PROGRESS;
-	game->level.dodger.obst_bmps.cherry = LoadScaledBitmap("levels/dodger/cherry.png", game->viewportWidth*0.03, game->viewportHeight*0.08);
+	game->level.dodger.obst_bmps.cherry = Prefetch_LoadBitmap(game, "levels/dodger/cherry.png", game->viewportWidth*0.03, game->viewportHeight*0.08);
 	PROGRESS;
-	game->level.dodger.obst_bmps.badmuffin = LoadScaledBitmap("levels/dodger/badmuffin.png", game->viewportWidth*0.07, game->viewportHeight*0.1);
+	game->level.dodger.obst_bmps.badmuffin = Prefetch_LoadBitmap(game, "levels/dodger/badmuffin.png", game->viewportWidth*0.07, game->viewportHeight*0.1);
 	PROGRESS;
 }
 
+void Dodger_Prefetch(struct Game *game) {
+	/* Derpy animations other than the initial one are loaded when the timeline gets close to them */
+	Prefetch_Bitmap(game, "levels/dodger/pie1.png", game->viewportWidth*0.1, game->viewportHeight*0.08);
+	Prefetch_Bitmap(game, "levels/dodger/pie2.png", game->viewportWidth*0.1, game->viewportHeight*0.08);
+	Prefetch_Bitmap(game, "levels/dodger/pig.png", (int)(game->viewportWidth*0.15)*3, (int)(game->viewportHeight*0.2)*3);
+	Prefetch_Bitmap(game, "levels/dodger/screwball.png", (int)(game->viewportHeight*0.2)*4*1.4, (int)(game->viewportHeight*0.2)*4);
+	Prefetch_Bitmap(game, "levels/dodger/muffin.png", game->viewportWidth*0.07, game->viewportHeight*0.1);
+	Prefetch_Bitmap(game, "levels/dodger/cherry.png", game->viewportWidth*0.03, game->viewportHeight*0.08);
+	Prefetch_Bitmap(game, "levels/dodger/badmuffin.png", game->viewportWidth*0.07, game->viewportHeight*0.1);
+}
+
 void Dodger_Preload(struct Game *game) {
-	RegisterDerpySpritesheet(game, "walk");
-	RegisterDerpySpritesheet(game, "stand");
-	RegisterDerpySpritesheet(game, "fly");
-	RegisterDerpySpritesheet(game, "run");
+	game->level.dodger.sheet_walk = RegisterDerpySpritesheet(game, "walk");
+	game->level.dodger.sheet_fly = RegisterDerpySpritesheet(game, "fly");
+	game->level.dodger.sheet_run = RegisterDerpySpritesheet(game, "run");
 }
 
 void Dodger_UnloadBitmaps(struct Game *game) {
@@ -259,20 +269,12 @@ void Dodger_UnloadBitmaps(struct Game *game) {
 
 void Dodger_Unload(struct Game *game) {
 	struct Obstacle *t = game->level.dodger.obstacles;
-	if (t) {
-		while (t->next) {
-			if (t->prev) free(t->prev);
-			t = t->next;
-		}
-		free(t);
-	}
-	struct Spritesheet *tmp, *s = game->level.derpy_sheets;
-	tmp = s;
-	while (s) {
-		tmp = s;
-		s = s->next;
-		free(tmp);
+	while (t) {
+		struct Obstacle *next = t->next;
+		DestroyObstacle(t);
+		t = next;
 	}
+	game->level.dodger.obstacles = NULL;
 }
 
 void Dodger_Resume(struct Game *game) {}
@@ -28,6 +28,7 @@ void Dodger_Load(struct Game *game);
 void Dodger_Keydown(struct Game *game, ALLEGRO_EVENT *ev);
 void Dodger_UnloadBitmaps(struct Game *game);
 void Dodger_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float));
+void Dodger_Prefetch(struct Game *game);
 void Dodger_ProcessEvent(struct Game *game, ALLEGRO_EVENT *ev);
 void Dodger_Resume(struct Game *game);
 void Dodger_Pause(struct Game *game);
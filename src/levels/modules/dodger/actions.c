@@ -34,7 +34,11 @@ bool Accelerate(struct Game *game, struct TM_Action *action, enum TM_ActionState
 
 // TODO: make it configurable and move to generic actions
 bool Walk(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
-	if (state == TM_ACTIONSTATE_START) SelectDerpySpritesheet(game, "walk");
+	if (state == TM_ACTIONSTATE_INIT) {
+		action->spritesheet = game->level.dodger.sheet_walk;
+		return false;
+	}
+	if (state == TM_ACTIONSTATE_START) SelectDerpySpritesheet(game, game->level.dodger.sheet_walk);
 	else if (state != TM_ACTIONSTATE_RUNNING) return false;
 	game->level.derpy_x+=0.001;
 	if (game->level.derpy_x>=0.05) return true;
@@ -50,8 +54,12 @@ bool Move(struct Game *game, struct TM_Action *action, enum TM_ActionState state
 }
 
 bool Fly(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
+	if (state == TM_ACTIONSTATE_INIT) {
+		action->spritesheet = game->level.dodger.sheet_fly;
+		return false;
+	}
 	if (state == TM_ACTIONSTATE_START) {
-		SelectDerpySpritesheet(game, "fly");
+		SelectDerpySpritesheet(game, game->level.dodger.sheet_fly);
 		game->level.derpy_angle = -0.15;
 		TM_AddBackgroundAction(&ShowMeter, NULL, 0, "showmeter");
 	}
@@ -65,13 +73,17 @@ bool Fly(struct Game *game, struct TM_Action *action, enum TM_ActionState state)
 }
 
 bool Run(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
+	if (state == TM_ACTIONSTATE_INIT) {
+		action->spritesheet = game->level.dodger.sheet_run;
+		return false;
+	}
 	if (state == TM_ACTIONSTATE_START) {
 		game->level.handle_input=false;
 		game->level.speed_modifier=1;
 	}
 	else if (state == TM_ACTIONSTATE_DESTROY) {
 		game->level.derpy_angle = 0;
-		SelectDerpySpritesheet(game, "run");
+		SelectDerpySpritesheet(game, game->level.dodger.sheet_run);
 	}
 	else if (state != TM_ACTIONSTATE_RUNNING) return false;
 	game->level.derpy_y+=0.0042;
@@ -82,6 +94,7 @@ bool Run(struct Game *game, struct TM_Action *action, enum TM_ActionState state)
 }
 
 bool GenerateObstacles(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
+	struct RNG *rng = &game->level.rng.obstacles;
 	int* count;
 	if (!action->arguments) {
 		action->arguments = TM_AddToArgs(action->arguments, malloc(sizeof(int)));
@@ -91,13 +104,13 @@ bool GenerateObstacles(struct Game *game, struct TM_Action *action, enum TM_Acti
 		*count = 0;
 	}
 	else if (state == TM_ACTIONSTATE_RUNNING) {
-		if (rand()%(10000/(int)(85*game->level.speed_modifier))<=3) {
+		if (RNG_Range(rng, 10000/(int)(85*game->level.speed_modifier))<=3) {
 			PrintConsole(game, "OBSTACLE %d", *count);
 			(*count)++;
 			struct Obstacle *obst = malloc(sizeof(struct Obstacle));
 			obst->prev = NULL;
 			obst->x = 100;
-			obst->y = (rand()%91)-1;
+			obst->y = RNG_Range(rng, 91)-1;
 			obst->speed = 1;
 			obst->points = -10;
 			obst->hit = false;
@@ -108,35 +121,35 @@ bool GenerateObstacles(struct Game *game, struct TM_Action *action, enum TM_Acti
 			obst->anim_speed = 0;
 			obst->tmp_pos = 0;
 			obst->angle = 0;
-			if (rand()%100<=50) {
+			if (RNG_Range(rng, 100)<=50) {
 				obst->callback= NULL;
 				obst->data = NULL;
 				obst->points = -5;
 				obst->bitmap = &(game->level.dodger.obst_bmps.badmuffin);
-			} else if (rand()%100<=12) {
+			} else if (RNG_Range(rng, 100)<=12) {
 				obst->callback= &Obst_RotateSin;
 				obst->data = malloc(sizeof(float));
 				*((float*)obst->data) = 0;
 				obst->points = 8;
 				obst->bitmap = &(game->level.dodger.obst_bmps.muffin);
-			} else if (rand()%100<=12) {
+			} else if (RNG_Range(rng, 100)<=12) {
 				obst->callback= &Obst_RotateSin;
 				obst->data = malloc(sizeof(float));
 				*((float*)obst->data) = 0;
 				obst->points = 4;
 				obst->bitmap = &(game->level.dodger.obst_bmps.cherry);
-			} else if (rand()%100<=65) {
+			} else if (RNG_Range(rng, 100)<=65) {
 				obst->callback= &Obst_MoveUp;
-				if (rand()%100<=80) obst->bitmap = &(game->level.dodger.obst_bmps.pie1);
+				if (RNG_Range(rng, 100)<=80) obst->bitmap = &(game->level.dodger.obst_bmps.pie1);
 				else {
 					obst->bitmap = &(game->level.dodger.obst_bmps.pie2);
 					obst->points = -12;
 				}
 				obst->data = malloc(sizeof(float));
-				*((float*)obst->data) = 0.25+(rand()%50/100.0);
+				*((float*)obst->data) = 0.25+(RNG_Range(rng, 50)/100.0);
 				obst->y*=1.8;
-				obst->angle = ((rand()%50)/100.0)-0.25;
-			} else if (rand()%100<=80) {
+				obst->angle = (RNG_Range(rng, 50)/100.0)-0.25;
+			} else if (RNG_Range(rng, 100)<=80) {
 				obst->callback = &Obst_MoveSin;
 				obst->data = malloc(sizeof(float));
 				*((float*)obst->data) = 0;
@@ -150,7 +163,7 @@ bool GenerateObstacles(struct Game *game, struct TM_Action *action, enum TM_Acti
 				obst->callback = &Obst_MoveUpDown;
 				obst->bitmap = &(game->level.dodger.obst_bmps.screwball);
 				obst->data = malloc(sizeof(bool));
-				*((bool*)obst->data) = rand()%2;
+				*((bool*)obst->data) = RNG_Range(rng, 2);
 				obst->rows = 4;
 				obst->cols = 4;
 				obst->speed = 1.1;
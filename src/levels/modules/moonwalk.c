@@ -21,12 +21,15 @@
 #include <stdio.h>
 #include <math.h>
 #include "../../gamestates/level.h"
+#include "../../prefetch.h"
+#include "../../text.h"
 #include "moonwalk.h"
 
 // TODO: use Walk action instead
 bool DoMoonwalk(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
-	if (state == TM_ACTIONSTATE_START) {
-		SelectDerpySpritesheet(game, "walk");
+	if (state == TM_ACTIONSTATE_INIT) action->spritesheet = game->level.moonwalk.sheet_walk;
+	else if (state == TM_ACTIONSTATE_START) {
+		SelectDerpySpritesheet(game, game->level.moonwalk.sheet_walk);
 		game->level.sheet_speed_modifier = 0.94;
 		game->level.moonwalk.derpy_pos = -0.2;
 	}
@@ -49,13 +52,16 @@ void Moonwalk_Draw(struct Game *game) {
 
 	al_draw_scaled_bitmap(game->level.stage,0,0,al_get_bitmap_width(game->level.stage),al_get_bitmap_height(game->level.stage),0,0,game->viewportWidth, game->viewportHeight,0);
 	al_draw_bitmap(game->level.derpy, game->level.moonwalk.derpy_pos*game->viewportWidth, game->viewportHeight*0.95-al_get_bitmap_height(game->level.derpy), ALLEGRO_FLIP_HORIZONTAL);
-	al_draw_textf(game->font, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight/2.2, ALLEGRO_ALIGN_CENTRE, "Level %d: Not implemented yet!", game->level.current_level);
-	al_draw_text(game->font, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight/1.8, ALLEGRO_ALIGN_CENTRE, "Have some moonwalk instead.");
+	al_hold_bitmap_drawing(true);
+	Text_Draw(game, game->font, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight/2.2, ALLEGRO_ALIGN_CENTRE, game->level.moonwalk.title);
+	Text_Draw(game, game->font, al_map_rgb(255,255,255), game->viewportWidth/2, game->viewportHeight/1.8, ALLEGRO_ALIGN_CENTRE, "Have some moonwalk instead.");
+	al_hold_bitmap_drawing(false);
 }
 
 void Moonwalk_Load(struct Game *game) {
 	game->level.moonwalk.derpy_pos = 0;
-	al_play_sample_instance(game->level.music);
+	snprintf(game->level.moonwalk.title, sizeof(game->level.moonwalk.title), "Level %d: Not implemented yet!", game->level.current_level);
+	if (game->level.music) al_set_audio_stream_playing(game->level.music, true);
 }
 
 void Moonwalk_Keydown(struct Game *game, ALLEGRO_EVENT *ev) {}
@@ -68,16 +74,21 @@ void Moonwalk_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, f
 	PROGRESS_INIT(Moonwalk_PreloadSteps());
 	// nasty hack: overwrite level background
 	al_destroy_bitmap(game->level.stage);
-	game->level.stage = LoadScaledBitmap("levels/moonwalk/disco.jpg", game->viewportWidth, game->viewportHeight);
+	game->level.stage = Prefetch_LoadBitmap(game, "levels/moonwalk/disco.jpg", game->viewportWidth, game->viewportHeight);
 	PROGRESS;
-	al_set_target_bitmap(al_get_backbuffer(game->display));
+	if (game->display) al_set_target_bitmap(al_get_backbuffer(game->display));
+}
+
+void Moonwalk_Prefetch(struct Game *game) {
+	/* walking animation is loaded when the timeline gets close to it */
+	Prefetch_Bitmap(game, "levels/moonwalk/disco.jpg", game->viewportWidth, game->viewportHeight);
 }
 
 void Moonwalk_Preload(struct Game *game) {
-	RegisterDerpySpritesheet(game, "walk");
-	// nasty hack: overwrite level music
-	al_destroy_sample(game->level.sample);
-	game->level.sample = al_load_sample( GetDataFilePath("levels/moonwalk/moonwalk.flac") );
+	game->level.moonwalk.sheet_walk = RegisterDerpySpritesheet(game, "walk");
+	// use moonwalk music instead of level one
+	if (!game->display) return;
+	game->level.music = LoadMusic(game, "levels/moonwalk/moonwalk.flac");
 }
 
 void Moonwalk_UnloadBitmaps(struct Game *game) {}
@@ -30,6 +30,7 @@ void Moonwalk_Load(struct Game *game);
 void Moonwalk_Keydown(struct Game *game, ALLEGRO_EVENT *ev);
 void Moonwalk_UnloadBitmaps(struct Game *game);
 void Moonwalk_PreloadBitmaps(struct Game *game, void (*progress)(struct Game*, float));
+void Moonwalk_Prefetch(struct Game *game);
 void Moonwalk_ProcessEvent(struct Game *game, ALLEGRO_EVENT *ev);
 void Moonwalk_Resume(struct Game *game);
 void Moonwalk_Pause(struct Game *game);
@@ -26,6 +26,7 @@
 #include <getopt.h>
 #include <locale.h>
 #include <signal.h>
+#include <time.h>
 #include "gamestates/menu.h"
 #include "gamestates/loading.h"
 #include "gamestates/about.h"
@@ -35,45 +36,37 @@
 #include "gamestates/pause.h"
 #include "gamestates/disclaimer.h"
 #include "config.h"
-
-/*! \brief Macro for preloading gamestate.
- *
- *  Preloading of state happens when loading screen is displayed.
- */
-#define PRELOAD_STATE(state, name) case state:\
-	PrintConsole(game, "Preload %s...", #state); DrawConsole(game); al_flip_display(); name ## _Preload(game, progress); break;
-/*! \brief Macro for unloading gamestate.
- *
- *  Unloading of state happens after it's fadeout.
- */
-#define UNLOAD_STATE(state, name) case state:\
-	PrintConsole(game, "Unload %s...", #state); name ## _Unload(game); break;
-/*! \brief Macro for loading gamestate.
- *
- *  Loading of state means setting it as active and running it.
- */
-#define LOAD_STATE(state, name) case state:\
-	PrintConsole(game, "Load %s...", #state); name ## _Load(game); break;
-/*! \brief Macro for sending keydown events to gamestate. */
-#define KEYDOWN_STATE(state, name) else if (game.gamestate==state) { if (name ## _Keydown(&game, &ev)) break; }
-/*! \brief Macro for drawing active gamestate. */
-#define DRAW_STATE(state, name) case state:\
-	name ## _Draw(game); break;
-/*! \brief Macro for invoking logic function of active gamestate. */
-#define LOGIC_STATE(state, name) case state:\
-	name ## _Logic(game); break;
-/*! \brief Macro for invoking pause function of active gamestate. */
-#define PAUSE_STATE(state, name) case state:\
-	PrintConsole(game, "Pause %s...", #state); name ## _Pause(game); break;
-/*! \brief Macro for invoking resume function of active gamestate. */
-#define RESUME_STATE(state, name) case state:\
-	PrintConsole(game, "Resume %s...", #state); name ## _Resume(game); break;
+#include "replay.h"
+#include "balance.h"
+#include "font.h"
+#include "assets.h"
+#include "prefetch.h"
+#include "archive.h"
+#include "texture.h"
+#include "bake.h"
+#include "text.h"
+#include "pacer.h"
+#include "transition.h"
+#include "pool.h"
+
+/*! \brief Table of all gamestates, indexed by gamestate_enum. */
+struct Gamestate gamestates[GAMESTATE_COUNT] = {
+	[GAMESTATE_PAUSE] = { .name = "GAMESTATE_PAUSE", .Load = &Pause_Load, .Unload = &Pause_Unload, .Draw = &Pause_Draw, .Keydown = &Pause_Keydown },
+	[GAMESTATE_LOADING] = { .name = "GAMESTATE_LOADING", .Preload = &Loading_Preload, .Load = &Loading_Load, .Unload = &Loading_Unload, .Draw = &Loading_Draw, .Logic = &Loading_Logic, .Keydown = &Loading_Keydown },
+	[GAMESTATE_MENU] = { .name = "GAMESTATE_MENU", .Preload = &Menu_Preload, .Load = &Menu_Load, .Unload = &Menu_Unload, .Stop = &Menu_Stop, .Draw = &Menu_Draw, .Logic = &Menu_Logic, .Keydown = &Menu_Keydown },
+	[GAMESTATE_ABOUT] = { .name = "GAMESTATE_ABOUT", .Preload = &About_Preload, .Load = &About_Load, .Unload = &About_Unload, .Draw = &About_Draw, .Logic = &About_Logic, .Keydown = &About_Keydown },
+	[GAMESTATE_INTRO] = { .name = "GAMESTATE_INTRO", .Preload = &Intro_Preload, .Load = &Intro_Load, .Unload = &Intro_Unload, .Draw = &Intro_Draw, .Logic = &Intro_Logic, .Keydown = &Intro_Keydown },
+	[GAMESTATE_MAP] = { .name = "GAMESTATE_MAP", .Preload = &Map_Preload, .Load = &Map_Load, .Unload = &Map_Unload, .Draw = &Map_Draw, .Logic = &Map_Logic, .Keydown = &Map_Keydown },
+	[GAMESTATE_LEVEL] = { .name = "GAMESTATE_LEVEL", .Preload = &Level_Preload, .Load = &Level_Load, .Unload = &Level_Unload, .Draw = &Level_Draw, .Logic = &Level_Logic, .Keydown = &Level_Keydown, .ProcessEvent = &Level_ProcessEvent, .Pause = &Level_Pause, .Resume = &Level_Resume },
+	[GAMESTATE_DISCLAIMER] = { .name = "GAMESTATE_DISCLAIMER", .Preload = &Disclaimer_Preload, .Load = &Disclaimer_Load, .Unload = &Disclaimer_Unload, .Draw = &Disclaimer_Draw, .Keydown = &Disclaimer_Keydown }
+};
 
 double old_time = 0, fps;
 int frames_done = 0;
 bool memoryscale;
+bool headless = false;
 
-char* GetDataFilePath(char* filename) {
+char* FindDataFilePath(char* filename) {
 
 	char *result = 0;
 
@@ -88,6 +81,13 @@ char* GetDataFilePath(char* filename) {
 		return strdup(origfn);
 	}
 
+	/* loose files in working directory take precedence, so data can be edited without repacking */
+	if (Archive_Contains(filename)) {
+		result = malloc(strlen(ARCHIVE_PREFIX)+strlen(filename)+1);
+		sprintf(result, "%s%s", ARCHIVE_PREFIX, filename);
+		return result;
+	}
+
 	void TestPath(char* subpath) {
 		ALLEGRO_PATH *tail = al_create_path(filename);
 		ALLEGRO_PATH *path = al_get_standard_path(ALLEGRO_RESOURCES_PATH);
@@ -107,6 +107,11 @@ char* GetDataFilePath(char* filename) {
 	TestPath("../Resources/data/");
 	TestPath("data/");
 
+	return result;
+}
+
+char* GetDataFilePath(char* filename) {
+	char *result = FindDataFilePath(filename);
 	if (!result) {
 		printf("FATAL: Could not find data file: %s!\n", filename);
 		exit(1);
@@ -121,16 +126,18 @@ void PrintConsole(struct Game *game, char* format, ...) {
 	vsprintf(text, format, vl);
 	va_end(vl);
 	if (game->debug) { printf("%s\n", text); fflush(stdout); }
-	ALLEGRO_BITMAP *con = al_create_bitmap(al_get_bitmap_width(game->console), al_get_bitmap_height(game->console));
-	al_set_target_bitmap(con);
-	al_clear_to_color(al_map_rgba(0,0,0,80));
-	al_draw_bitmap_region(game->console, 0, al_get_bitmap_height(game->console)*0.2, al_get_bitmap_width(game->console), al_get_bitmap_height(game->console)*0.8, 0, 0, 0);
-	al_draw_text(game->font_console, al_map_rgb(255,255,255), game->viewportWidth*0.005, al_get_bitmap_height(game->console)*0.81, ALLEGRO_ALIGN_LEFT, text);
-	al_set_target_bitmap(game->console);
-	al_clear_to_color(al_map_rgba(0,0,0,0));
-	al_draw_bitmap(con, 0, 0, 0);
-	al_set_target_bitmap(al_get_backbuffer(game->display));
-	al_destroy_bitmap(con);
+	if (!game->display) return;
+	void Scroll(struct Game *game, ALLEGRO_BITMAP *con) {
+		al_set_target_bitmap(con);
+		al_clear_to_color(al_map_rgba(0,0,0,80));
+		al_draw_bitmap_region(game->console, 0, al_get_bitmap_height(game->console)*0.2, al_get_bitmap_width(game->console), al_get_bitmap_height(game->console)*0.8, 0, 0, 0);
+		al_draw_text(game->font_console, al_map_rgb(255,255,255), game->viewportWidth*0.005, al_get_bitmap_height(game->console)*0.81, ALLEGRO_ALIGN_LEFT, text);
+		al_set_target_bitmap(game->console);
+		al_clear_to_color(al_map_rgba(0,0,0,0));
+		al_draw_bitmap(con, 0, 0, 0);
+		al_set_target_bitmap(al_get_backbuffer(game->display));
+	}
+	Pool_Use(game, al_get_bitmap_width(game->console), al_get_bitmap_height(game->console), &Scroll);
 }
 
 void DrawConsole(struct Game *game) {
@@ -142,166 +149,147 @@ void DrawConsole(struct Game *game) {
 			frames_done = 0;
 			old_time = game_time;
 		}
-		char sfps[6] = { };
-		sprintf(sfps, "%.0f", fps);
+		char sfps[32] = { };
+		if (game->dropped_ticks) snprintf(sfps, sizeof(sfps), "%.0f (%u ticks dropped)", fps, game->dropped_ticks);
+		else snprintf(sfps, sizeof(sfps), "%.0f", fps);
 		al_draw_text_with_shadow(game->font, al_map_rgb(255,255,255), game->viewportWidth*0.99, 0, ALLEGRO_ALIGN_RIGHT, sfps);
 	}
 	frames_done++;
 }
 
+/*! \brief Returns descriptor of given gamestate, or NULL if there's no such state. */
+struct Gamestate* GetGameState(enum gamestate_enum state) {
+	if ((state < 0) || (state >= GAMESTATE_COUNT) || (!gamestates[state].name)) return NULL;
+	return &gamestates[state];
+}
+
 void PreloadGameState(struct Game *game, void (*progress)(struct Game*, float)) {
-	if (game->loadstate<1) {
+	struct Gamestate *state = GetGameState(game->loadstate);
+	if ((!state) || (!state->Preload)) {
 		PrintConsole(game, "ERROR: Attempted to preload invalid gamestate %d! Loading GAMESTATE_MENU instead...", game->loadstate);
 		game->loadstate = GAMESTATE_MENU;
+		state = GetGameState(game->loadstate);
 	}
 	if ((game->loadstate==GAMESTATE_MENU) && (game->menu.loaded)) {
 		PrintConsole(game, "GAMESTATE_MENU already loaded, skipping...");
 		return;
 	}
-	switch (game->loadstate) {
-		PRELOAD_STATE(GAMESTATE_MENU, Menu)
-		PRELOAD_STATE(GAMESTATE_LOADING, Loading)
-		PRELOAD_STATE(GAMESTATE_ABOUT, About)
-		PRELOAD_STATE(GAMESTATE_INTRO, Intro)
-		PRELOAD_STATE(GAMESTATE_MAP, Map)
-		PRELOAD_STATE(GAMESTATE_LEVEL, Level)
-		PRELOAD_STATE(GAMESTATE_DISCLAIMER, Disclaimer)
-		default:
-			PrintConsole(game, "ERROR: Attempted to preload unknown gamestate %d!", game->loadstate);
-		break;
+	PrintConsole(game, "Preload %s...", state->name);
+	if (game->display) {
+		DrawConsole(game);
+		al_flip_display();
 	}
+	Track_SetTag(state->name);
+	state->Preload(game, progress);
 	PrintConsole(game, "finished");
 }
 
 void UnloadGameState(struct Game *game) {
-	switch (game->gamestate) {
-		case GAMESTATE_MENU:
-			if (game->shuttingdown) {
-				PrintConsole(game, "Unload GAMESTATE_MENU..."); Menu_Unload(game);
-			} else {
-				PrintConsole(game, "Just stopping GAMESTATE_MENU..."); Menu_Stop(game);
-			}
-			break;
-		UNLOAD_STATE(GAMESTATE_PAUSE, Pause)
-		UNLOAD_STATE(GAMESTATE_LOADING, Loading)
-		UNLOAD_STATE(GAMESTATE_ABOUT, About)
-		UNLOAD_STATE(GAMESTATE_INTRO, Intro)
-		UNLOAD_STATE(GAMESTATE_MAP, Map)
-		UNLOAD_STATE(GAMESTATE_LEVEL, Level)
-		UNLOAD_STATE(GAMESTATE_DISCLAIMER, Disclaimer)
-		default:
+	while (true) {
+		struct Gamestate *state = GetGameState(game->gamestate);
+		if (!state) {
 			PrintConsole(game, "ERROR: Attempted to unload unknown gamestate %d!", game->gamestate);
-			break;
+		} else if ((state->Stop) && (!game->shuttingdown)) {
+			PrintConsole(game, "Just stopping %s...", state->name);
+			state->Stop(game);
+		} else {
+			PrintConsole(game, "Unload %s...", state->name);
+			Track_SetTag(state->name);
+			state->Unload(game);
+			Track_Report(game, state->name);
+		}
+		if (!game->stack_depth) break;
+		game->gamestate = game->stack[--game->stack_depth];
 	}
 	PrintConsole(game, "finished");
 }
 
 void LoadGameState(struct Game *game) {
+	struct Gamestate *state = GetGameState(game->loadstate);
 	game->gamestate = game->loadstate;
 	game->loadstate = -1;
-	switch (game->gamestate) {
-		LOAD_STATE(GAMESTATE_MENU, Menu)
-		LOAD_STATE(GAMESTATE_LOADING, Loading)
-		LOAD_STATE(GAMESTATE_ABOUT, About)
-		LOAD_STATE(GAMESTATE_INTRO, Intro)
-		LOAD_STATE(GAMESTATE_MAP, Map)
-		LOAD_STATE(GAMESTATE_LEVEL, Level)
-		LOAD_STATE(GAMESTATE_DISCLAIMER, Disclaimer)
-		default:
-			PrintConsole(game, "ERROR: Attempted to load unknown gamestate %d!", game->loadstate);
+	if (!state) {
+		PrintConsole(game, "ERROR: Attempted to load unknown gamestate %d!", game->gamestate);
+		return;
 	}
+	PrintConsole(game, "Load %s...", state->name);
+	Track_SetTag(state->name);
+	state->Load(game);
+	/* gamestate which doesn't fade in by itself is crossfaded from the previous one anyway */
+	if (game->transition.mode == TRANSITION_OUT) Transition_In(game);
 	PrintConsole(game, "finished");
 }
 
-void DrawGameState(struct Game *game) {
-	switch (game->gamestate) {
-		DRAW_STATE(GAMESTATE_MENU, Menu)
-		DRAW_STATE(GAMESTATE_PAUSE, Pause)
-		DRAW_STATE(GAMESTATE_LOADING, Loading)
-		DRAW_STATE(GAMESTATE_ABOUT, About)
-		DRAW_STATE(GAMESTATE_INTRO, Intro)
-		DRAW_STATE(GAMESTATE_MAP, Map)
-		DRAW_STATE(GAMESTATE_LEVEL, Level)
-		DRAW_STATE(GAMESTATE_DISCLAIMER, Disclaimer)
-		default:
-			game->showconsole = true;
-			al_clear_to_color(al_map_rgb(0,0,0));
-			PrintConsole(game, "ERROR: Unknown gamestate %d reached! (5 sec sleep)", game->gamestate);
-			DrawConsole(game);
-			al_flip_display();
-			al_rest(5.0);
-			PrintConsole(game, "Returning to menu...");
-			game->gamestate = GAMESTATE_LOADING;
-			game->loadstate = GAMESTATE_MENU;
-			break;
+void PushGameState(struct Game *game, enum gamestate_enum state) {
+	struct Gamestate *current = GetGameState(game->gamestate), *next = GetGameState(state);
+	if ((!next) || (game->stack_depth >= GAMESTATE_STACK_SIZE)) {
+		PrintConsole(game, "ERROR: Can't push gamestate %d over %d!", state, game->gamestate);
+		return;
+	}
+	if ((current) && (current->Pause)) {
+		PrintConsole(game, "Pause %s...", current->name);
+		current->Pause(game);
 	}
+	game->stack[game->stack_depth++] = game->gamestate;
+	game->gamestate = state;
+	PrintConsole(game, "Load %s...", next->name);
+	Track_SetTag(next->name);
+	next->Load(game);
 }
 
-void LogicGameState(struct Game *game) {
-	switch (game->gamestate) {
-		LOGIC_STATE(GAMESTATE_ABOUT, About)
-		LOGIC_STATE(GAMESTATE_MENU, Menu)
-		LOGIC_STATE(GAMESTATE_MAP, Map)
-		LOGIC_STATE(GAMESTATE_INTRO, Intro)
-		LOGIC_STATE(GAMESTATE_LEVEL, Level)
-		default:
-			// not every gamestate needs to have logic function
-			break;
+void PopGameState(struct Game *game) {
+	struct Gamestate *current = GetGameState(game->gamestate);
+	if (!game->stack_depth) {
+		PrintConsole(game, "ERROR: Attempted to pop gamestate %d with nothing below it!", game->gamestate);
+		return;
+	}
+	if (current) {
+		PrintConsole(game, "Unload %s...", current->name);
+		current->Unload(game);
+		Track_Report(game, current->name);
+	}
+	game->gamestate = game->stack[--game->stack_depth];
+	current = GetGameState(game->gamestate);
+	if (current) Track_SetTag(current->name);
+	if ((current) && (current->Resume)) {
+		PrintConsole(game, "Resume %s...", current->name);
+		current->Resume(game);
 	}
 }
 
-void PauseGameState(struct Game *game) {
-	switch (game->loadstate) {
-		PAUSE_STATE(GAMESTATE_LEVEL, Level)
-		default:
-			// not every gamestate needs to have pause function
-			break;
+void DrawGameState(struct Game *game) {
+	struct Gamestate *state = GetGameState(game->gamestate);
+	if (!state) {
+		game->showconsole = true;
+		al_clear_to_color(al_map_rgb(0,0,0));
+		PrintConsole(game, "ERROR: Unknown gamestate %d reached! (5 sec sleep)", game->gamestate);
+		DrawConsole(game);
+		al_flip_display();
+		al_rest(5.0);
+		PrintConsole(game, "Returning to menu...");
+		game->stack_depth = 0;
+		game->gamestate = GAMESTATE_LOADING;
+		game->loadstate = GAMESTATE_MENU;
+		return;
 	}
+	int i;
+	for (i=0; i<game->stack_depth; i++) {
+		GetGameState(game->stack[i])->Draw(game);
+	}
+	state->Draw(game);
+	Transition_Draw(game);
 }
 
-void ResumeGameState(struct Game *game) {
-	switch (game->loadstate) {
-		RESUME_STATE(GAMESTATE_LEVEL, Level)
-		default:
-			// not every gamestate needs to have resume function
-			break;
-	}
+void LogicGameState(struct Game *game) {
+	struct Gamestate *state = GetGameState(game->gamestate);
+	// not every gamestate needs to have logic function
+	if ((state) && (state->Logic)) state->Logic(game);
+	Transition_Logic(game);
 }
 
 void FadeGameState(struct Game *game, bool in) {
-	ALLEGRO_BITMAP* bitmap = al_create_bitmap(game->viewportWidth, game->viewportHeight);
-	al_set_target_bitmap(bitmap);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	al_set_target_bitmap(al_get_backbuffer(game->display));
-	float fadeloop;
-	if (in) {
-		fadeloop = 255;
-	} else {
-		fadeloop = 0;
-	}
-	while ((in && fadeloop>=0) || (!in && fadeloop<255)) {
-		ALLEGRO_EVENT ev;
-		al_wait_for_event(game->event_queue, &ev);
-		if ((ev.type == ALLEGRO_EVENT_TIMER) && (ev.timer.source == game->timer)) {
-			LogicGameState(game);
-			if (in) {
-				fadeloop-=10;
-			} else {
-				fadeloop+=10;
-			}
-		}
-		if (al_is_event_queue_empty(game->event_queue)) {
-			DrawGameState(game);
-			al_draw_tinted_bitmap(bitmap,al_map_rgba_f(1,1,1,fadeloop/255.0),0,0,0);
-			DrawConsole(game);
-			al_flip_display();
-		}
-	}
-	al_destroy_bitmap(bitmap);
-	al_clear_to_color(al_map_rgb(0,0,0));
-	if (in) {
-		DrawGameState(game);
-	}
+	if (in) Transition_In(game);
+	else Transition_Out(game);
 }
 
 /*! \brief Scales bitmap using software linear filtering method to current target. */
@@ -347,7 +335,17 @@ void ScaleBitmap(ALLEGRO_BITMAP* source, int width, int height) {
 }
 
 ALLEGRO_BITMAP* LoadScaledBitmap(char* filename, int width, int height) {
-	ALLEGRO_BITMAP *source, *target = al_create_bitmap(width, height);
+	ALLEGRO_BITMAP *source, *target;
+	/* nothing is ever shown without display, only the size matters */
+	if (headless) return al_create_bitmap(width, height);
+	/* bitmap baked offline at this size needs no decoding or scaling */
+	char* baked = Bake_Active() ? NULL : Texture_FindBaked(filename, width, height);
+	if (baked) {
+		source = al_load_bitmap(baked);
+		free(baked);
+		if (source) return source;
+	}
+	target = al_create_bitmap(width, height);
 	al_set_target_bitmap(target);
 	al_clear_to_color(al_map_rgba(0,0,0,0));
 	char* origfn = GetDataFilePath(filename);
@@ -373,6 +371,7 @@ ALLEGRO_BITMAP* LoadScaledBitmap(char* filename, int width, int height) {
 			al_destroy_bitmap(source);*/
 	GenerateBitmap();
 	free(origfn);
+	if (Bake_Active()) Bake_Store(filename, width, height, target);
 	return target;
 	/*	}
 		return source;
@@ -381,10 +380,34 @@ ALLEGRO_BITMAP* LoadScaledBitmap(char* filename, int width, int height) {
 }
 
 
+ALLEGRO_AUDIO_STREAM* LoadMusic(struct Game *game, char* filename) {
+	/* only a few fragments are decoded ahead, the rest of the track stays on disk */
+	int buffers = GetConfigInt("SuperDerpy", "stream_buffers", 4);
+	int samples = GetConfigInt("SuperDerpy", "stream_samples", 4096);
+	if (buffers < 2) buffers = 2;
+	if (samples < 256) samples = 256;
+	char* path = GetDataFilePath(filename);
+	ALLEGRO_AUDIO_STREAM *music = al_load_audio_stream(path, buffers, samples);
+	free(path);
+	if (!music) {
+		fprintf(stderr, "Music %s not loaded!\n", filename);
+		exit(-1);
+	}
+	al_set_audio_stream_playing(music, false);
+	al_set_audio_stream_playmode(music, ALLEGRO_PLAYMODE_LOOP);
+	al_attach_audio_stream_to_mixer(music, game->audio.music);
+	return music;
+}
+
+void StopMusic(ALLEGRO_AUDIO_STREAM *music) {
+	al_set_audio_stream_playing(music, false);
+	al_rewind_audio_stream(music);
+}
+
 void SetupViewport(struct Game *game) {
 	game->viewportWidth = al_get_display_width(game->display);
 	game->viewportHeight = al_get_display_height(game->display);
-	if (atoi(GetConfigOptionDefault("SuperDerpy", "letterbox", "1"))) {
+	if (GetConfigInt("SuperDerpy", "letterbox", 1)) {
 		float const aspectRatio = (float)1920 / (float)1080; // full HD
 		int clipWidth = game->viewportWidth, clipHeight = game->viewportWidth / aspectRatio;
 		int clipX = 0, clipY = (game->viewportHeight - clipHeight) / 2;
@@ -407,12 +430,12 @@ void SetupViewport(struct Game *game) {
 }
 
 int Shared_Load(struct Game *game) {
-	game->font = al_load_ttf_font(GetDataFilePath("fonts/ShadowsIntoLight.ttf"),game->viewportHeight*0.09,0 );
+	game->font = Font_Load(game, "fonts/ShadowsIntoLight.ttf", game->viewportHeight*0.09);
 	if(!game->font) {
 		fprintf(stderr, "failed to load game font!\n");
 		return -1;
 	}
-	game->font_console = al_load_ttf_font(GetDataFilePath("fonts/DejaVuSansMono.ttf"),game->viewportHeight*0.018,0 );
+	game->font_console = Font_Load(game, "fonts/DejaVuSansMono.ttf", game->viewportHeight*0.018);
 	if(!game->font_console) {
 		fprintf(stderr, "failed to load console font!\n");
 		return -1;
@@ -421,13 +444,22 @@ int Shared_Load(struct Game *game) {
 	al_set_target_bitmap(game->console);
 	al_clear_to_color(al_map_rgba(0,0,0,80));
 	al_set_target_bitmap(al_get_backbuffer(game->display));
+	Text_Init(game);
 	return 0;
 }
 
 void Shared_Unload(struct Game *game) {
-	al_destroy_font(game->font);
-	al_destroy_font(game->font_console);
+	/* atlas refers to fonts, so it goes first */
+	Text_Destroy(game);
+	Font_UnloadAll(game);
 	al_destroy_bitmap(game->console);
+	/* idle targets won't match the new viewport */
+	Pool_Purge(game);
+}
+
+/*! \brief Applies changed volume entry to its mixer. */
+void SetVolume(int value, void* mixer) {
+	al_set_mixer_gain(mixer, value/10.0);
 }
 
 void derp(int sig) {
@@ -436,11 +468,23 @@ void derp(int sig) {
 	abort();
 }
 
+/*! \brief Prints command line usage. */
+void Usage(char* name) {
+	printf("Usage: %s [-l level] [-s gamestate] [-r replay] [-p replay [-n]] [-b runs [-j threads] [-S seed]] [-B directory]\n", name);
+	printf("  -l level      start given level\n");
+	printf("  -s gamestate  start given gamestate\n");
+	printf("  -r replay     record next level run into replay file\n");
+	printf("  -p replay     play back replay file\n");
+	printf("  -n            play back replay without display, as fast as possible\n");
+	printf("  -b runs       simulate runs of level (1 by default) for every bot policy and print balance report\n");
+	printf("  -j threads    number of simulation threads, all cores by default\n");
+	printf("  -S seed       seed of the first simulated run, current time by default\n");
+	printf("  -B directory  bake bitmaps scaled for standard viewport sizes into given data directory\n");
+}
+
 int main(int argc, char **argv){
 	signal(SIGSEGV, derp);
 
-	srand(time(NULL));
-
 	al_set_org_name("Super Derpy");
 	al_set_app_name("Muffin Attack");
 
@@ -450,19 +494,74 @@ int main(int argc, char **argv){
 	}
 
 	InitConfig();
+	Archive_Open();
 
 	struct Game game;
 
-	game.fullscreen = atoi(GetConfigOptionDefault("SuperDerpy", "fullscreen", "1"));
-	game.music = atoi(GetConfigOptionDefault("SuperDerpy", "music", "7"));
-	game.voice = atoi(GetConfigOptionDefault("SuperDerpy", "voice", "10"));
-	game.fx = atoi(GetConfigOptionDefault("SuperDerpy", "fx", "10"));
-	game.debug = atoi(GetConfigOptionDefault("SuperDerpy", "debug", "0"));
-	game.width = atoi(GetConfigOptionDefault("SuperDerpy", "width", "800"));
+	game.fullscreen = GetConfigInt("SuperDerpy", "fullscreen", 1);
+	game.music = GetConfigInt("SuperDerpy", "music", 7);
+	game.voice = GetConfigInt("SuperDerpy", "voice", 10);
+	game.fx = GetConfigInt("SuperDerpy", "fx", 10);
+	game.debug = GetConfigInt("SuperDerpy", "debug", 0);
+	game.fps = GetConfigInt("SuperDerpy", "fps", 0);
+	game.width = GetConfigInt("SuperDerpy", "width", 800);
 	if (game.width<320) game.width=320;
-	game.height = atoi(GetConfigOptionDefault("SuperDerpy", "height", "450"));
+	game.height = GetConfigInt("SuperDerpy", "height", 450);
 	if (game.height<200) game.height=180;
-	memoryscale = !atoi(GetConfigOptionDefault("SuperDerpy", "GPU_scaling", "1"));
+	memoryscale = !GetConfigInt("SuperDerpy", "GPU_scaling", 1);
+	game.replay = NULL;
+	Assets_Init(&game);
+	game.display = NULL;
+	game.level.input.seed = 0;
+	game.level.input.bot = NULL;
+	game.stack_depth = 0;
+	game.prefetch.thread = NULL;
+	game.prefetch.jobs = NULL;
+	game.transition.snapshot = NULL;
+	game.transition.mode = TRANSITION_NONE;
+	memset(&game.pool, 0, sizeof(game.pool));
+
+	int c, level = 0, state = -1, runs = 0, threads = 0;
+	unsigned int seed = time(NULL);
+	char *record = NULL, *playback = NULL, *bake = NULL;
+	optind = 1;
+	while ((c = getopt (argc, argv, "l:s:r:p:nb:j:S:B:")) != -1)
+		switch (c) {
+			case 'l':
+				level = optarg[0]-'0';
+				break;
+			case 's':
+				state = optarg[0]-'0';
+				break;
+			case 'r':
+				record = optarg;
+				break;
+			case 'p':
+				playback = optarg;
+				break;
+			case 'n':
+				headless = true;
+				break;
+			case 'b':
+				runs = atoi(optarg);
+				headless = true;
+				break;
+			case 'j':
+				threads = atoi(optarg);
+				break;
+			case 'S':
+				seed = strtoul(optarg, NULL, 10);
+				break;
+			case 'B':
+				bake = optarg;
+				break;
+			default:
+				Usage(argv[0]);
+				return -1;
+		}
+	if ((playback) && (!Replay_Play(&game, playback))) return -1;
+	if ((record) && (!playback) && (!Replay_Record(&game, record))) return -1;
+	if (playback) level = game.replay->level;
 
 	if(!al_init_image_addon()) {
 		fprintf(stderr, "failed to initialize image addon!\n");
@@ -470,18 +569,19 @@ int main(int argc, char **argv){
 															 NULL, ALLEGRO_MESSAGEBOX_ERROR);*/
 		return -1;
 	}
+	Texture_Init();
 
 	if(!al_init_acodec_addon()){
 		fprintf(stderr, "failed to initialize audio codecs!\n");
 		return -1;
 	}
 
-	if(!al_install_audio()){
+	if((!headless) && (!al_install_audio())){
 		fprintf(stderr, "failed to initialize audio!\n");
 		return -1;
 	}
 
-	if(!al_install_keyboard()){
+	if((!headless) && (!al_install_keyboard())){
 		fprintf(stderr, "failed to initialize keyboard!\n");
 		return -1;
 	}
@@ -503,10 +603,22 @@ int main(int argc, char **argv){
 		return -1;
 	}
 
+	if (headless) {
+		al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+		int ret;
+		if (runs) ret = Balance_Run(&game, runs, threads, level, seed);
+		else ret = Replay_RunHeadless(&game);
+		Replay_Close(&game);
+		FreeDerpySpritesheets(&game);
+		Pool_Destroy(&game);
+		Track_Report(NULL, NULL);
+		return ret;
+	}
+
 	if (game.fullscreen) al_set_new_display_flags(ALLEGRO_FULLSCREEN_WINDOW);
 	else al_set_new_display_flags(ALLEGRO_WINDOWED);
-	al_set_new_display_option(ALLEGRO_VSYNC, 2-atoi(GetConfigOptionDefault("SuperDerpy", "vsync", "1")), ALLEGRO_SUGGEST);
-	al_set_new_display_option(ALLEGRO_OPENGL, atoi(GetConfigOptionDefault("SuperDerpy", "opengl", "1")), ALLEGRO_SUGGEST);
+	al_set_new_display_option(ALLEGRO_VSYNC, 2-GetConfigInt("SuperDerpy", "vsync", 1), ALLEGRO_SUGGEST);
+	al_set_new_display_option(ALLEGRO_OPENGL, GetConfigInt("SuperDerpy", "opengl", 1), ALLEGRO_SUGGEST);
 	al_set_new_display_option(ALLEGRO_SAMPLE_BUFFERS, 1, ALLEGRO_SUGGEST);
 	al_set_new_display_option(ALLEGRO_SAMPLES, 8, ALLEGRO_SUGGEST);
 
@@ -515,7 +627,9 @@ int main(int argc, char **argv){
 		fprintf(stderr, "failed to create display!\n");
 		return -1;
 	}
-	ALLEGRO_BITMAP *icon = al_load_bitmap(GetDataFilePath("icons/superderpy.png"));
+	char* iconpath = GetDataFilePath("icons/superderpy.png");
+	ALLEGRO_BITMAP *icon = al_load_bitmap(iconpath);
+	free(iconpath);
 	al_set_window_title(game.display, "Super Derpy: Muffin Attack");
 	al_set_display_icon(game.display, icon);
 	al_destroy_bitmap(icon);
@@ -529,6 +643,7 @@ int main(int argc, char **argv){
 
 	int ret = Shared_Load(&game);
 	if (ret!=0) return ret;
+	Prefetch_Init(&game);
 
 	PrintConsole(&game, "Viewport %dx%d", game.viewportWidth, game.viewportHeight);
 
@@ -551,6 +666,9 @@ int main(int argc, char **argv){
 	al_set_mixer_gain(game.audio.fx, game.fx/10.0);
 	al_set_mixer_gain(game.audio.music, game.music/10.0);
 	al_set_mixer_gain(game.audio.voice, game.voice/10.0);
+	WatchConfigInt("SuperDerpy", "fx", 10, &SetVolume, game.audio.fx);
+	WatchConfigInt("SuperDerpy", "music", 7, &SetVolume, game.audio.music);
+	WatchConfigInt("SuperDerpy", "voice", 10, &SetVolume, game.audio.voice);
 
 	al_register_event_source(game.event_queue, al_get_display_event_source(game.display));
 	al_register_event_source(game.event_queue, al_get_keyboard_event_source());
@@ -559,7 +677,7 @@ int main(int argc, char **argv){
 
 	al_flip_display();
 	al_clear_to_color(al_map_rgb(0,0,0));
-	game.timer = al_create_timer(ALLEGRO_BPS_TO_SECS(60)); // logic timer
+	game.timer = al_create_timer(ALLEGRO_BPS_TO_SECS(LOGIC_FPS)); // logic timer
 	if(!game.timer) {
 		fprintf(stderr, "failed to create timer!\n");
 		return -1;
@@ -573,100 +691,121 @@ int main(int argc, char **argv){
 	game.shuttingdown = false;
 	game.menu.loaded = false;
 	game.restart = false;
+	game.dropped_ticks = 0;
+	if (bake) return Bake_Run(&game, bake);
 	game.loadstate = GAMESTATE_LOADING;
 	PreloadGameState(&game, NULL);
 	LoadGameState(&game);
 	game.loadstate = GAMESTATE_MENU;
+	if (state >= 0) game.loadstate = state;
+	if (level) {
+		game.level.input.current_level = level;
+		game.loadstate = GAMESTATE_LEVEL;
+	}
 
-	int c;
-	while ((c = getopt (argc, argv, "l:s:")) != -1)
-		switch (c) {
-			case 'l':
-				game.level.input.current_level = optarg[0]-'0';
-				game.loadstate = GAMESTATE_LEVEL;
-				break;
-			case 's':
-				game.loadstate = optarg[0]-'0';
-				break;
+	/* handles event other than logic tick, returns true if the game should quit */
+	bool HandleEvent(ALLEGRO_EVENT *ev) {
+		if (ev->type == ALLEGRO_EVENT_DISPLAY_CLOSE) {
+			return true;
+		}
+		else if (ev->type == ALLEGRO_EVENT_KEY_DOWN) {
+			/*PrintConsole(&game, "KEYCODE: %s", al_keycode_to_name(ev->keyboard.keycode));*/
+		#ifdef ALLEGRO_MACOSX
+			if ((ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == 104)) {
+		#else
+			if ((ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_TILDE)) {
+		#endif
+				game.showconsole = !game.showconsole;
+			}
+			else if ((game.debug) && (ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_F1)) {
+				int i;
+				for (i=0; i<512; i++) {
+					LogicGameState(&game);
+				}
+				game.showconsole = true;
+				PrintConsole(&game, "DEBUG: 512 frames skipped...");
+			}	else if ((game.debug) && (ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_F9)) {
+				game.showconsole = true;
+				Assets_Dump(&game);
+				Track_Dump(&game);
+				Pacer_Report(&game);
+				Pool_Dump(&game);
+			}	else if ((game.debug) && (ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_F10)) {
+				double speed = ALLEGRO_BPS_TO_SECS(al_get_timer_speed(game.timer)); // inverting
+				speed -= 10;
+				if (speed<10) speed = 10;
+				al_set_timer_speed(game.timer, ALLEGRO_BPS_TO_SECS(speed));
+				game.showconsole = true;
+				PrintConsole(&game, "DEBUG: Gameplay speed: %.2fx", speed/(double)LOGIC_FPS);
+			}	else if ((game.debug) && (ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_F11)) {
+				double speed = ALLEGRO_BPS_TO_SECS(al_get_timer_speed(game.timer)); // inverting
+				speed += 10;
+				if (speed>600) speed = 600;
+				al_set_timer_speed(game.timer, ALLEGRO_BPS_TO_SECS(speed));
+				game.showconsole = true;
+				PrintConsole(&game, "DEBUG: Gameplay speed: %.2fx", speed/(double)LOGIC_FPS);
+			} else if ((game.debug) && (ev->type == ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_F12)) {
+				ALLEGRO_PATH *path = al_get_standard_path(ALLEGRO_USER_DOCUMENTS_PATH);
+				char filename[255] = { };
+				sprintf(filename, "SuperDerpy_%ld_%ld.png", time(NULL), clock());
+				al_set_path_filename(path, filename);
+				al_save_bitmap(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP), al_get_backbuffer(game.display));
+				PrintConsole(&game, "Screenshot stored in %s", al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
+				al_destroy_path(path);
+			}
+			else if (GetGameState(game.gamestate)) {
+				if (GetGameState(game.gamestate)->Keydown(&game, ev)) return true;
+			}
+			else {
+				game.showconsole = true;
+				PrintConsole(&game, "ERROR: Keystroke in unknown (%d) gamestate! (5 sec sleep)", game.gamestate);
+				DrawConsole(&game);
+				al_flip_display();
+				al_rest(5.0);
+				PrintConsole(&game, "Returning to menu...");
+				game.stack_depth = 0;
+				game.gamestate = GAMESTATE_LOADING;
+				game.loadstate = GAMESTATE_MENU;
+			}
+		} else if ((GetGameState(game.gamestate)) && (GetGameState(game.gamestate)->ProcessEvent)) {
+			GetGameState(game.gamestate)->ProcessEvent(&game, ev);
 		}
+		return false;
+	}
 
+	Pacer_Init(&game);
 	while(1) {
 		ALLEGRO_EVENT ev;
-		if (al_is_event_queue_empty(game.event_queue)) {
+		if ((al_is_event_queue_empty(game.event_queue)) && (Pacer_Due(&game))) {
 			DrawGameState(&game);
 			DrawConsole(&game);
 			al_flip_display();
+			Pacer_Flipped(&game);
 		} else {
+			/* sleeps until next logic tick, input or frame tick */
 			al_wait_for_event(game.event_queue, &ev);
+			if (Pacer_Event(&game, &ev)) continue;
 			if ((ev.type == ALLEGRO_EVENT_TIMER) && (ev.timer.source == game.timer)) {
-				LogicGameState(&game);
-			}
-			else if(ev.type == ALLEGRO_EVENT_DISPLAY_CLOSE) {
-				break;
-			}
-			else if (ev.type == ALLEGRO_EVENT_KEY_DOWN) {
-				/*PrintConsole(&game, "KEYCODE: %s", al_keycode_to_name(ev.keyboard.keycode));*/
-			#ifdef ALLEGRO_MACOSX
-				if ((ev.type == ALLEGRO_EVENT_KEY_DOWN) && (ev.keyboard.keycode == 104)) {
-			#else
-				if ((ev.type == ALLEGRO_EVENT_KEY_DOWN) && (ev.keyboard.keycode == ALLEGRO_KEY_TILDE)) {
-			#endif
-					game.showconsole = !game.showconsole;
+				/* ticks which piled up during a long frame run in one batch, after input which came in meanwhile */
+				int ticks = 1;
+				bool quit = false;
+				while ((!quit) && (al_get_next_event(game.event_queue, &ev))) {
+					if (Pacer_Event(&game, &ev)) continue;
+					if ((ev.type == ALLEGRO_EVENT_TIMER) && (ev.timer.source == game.timer)) ticks++;
+					else quit = HandleEvent(&ev);
 				}
-				else if ((game.debug) && (ev.type == ALLEGRO_EVENT_KEY_DOWN) && (ev.keyboard.keycode == ALLEGRO_KEY_F1)) {
-					int i;
-					for (i=0; i<512; i++) {
-						LogicGameState(&game);
-					}
-					game.showconsole = true;
-					PrintConsole(&game, "DEBUG: 512 frames skipped...");
-				}	else if ((game.debug) && (ev.type == ALLEGRO_EVENT_KEY_DOWN) && (ev.keyboard.keycode == ALLEGRO_KEY_F10)) {
-					double speed = ALLEGRO_BPS_TO_SECS(al_get_timer_speed(game.timer)); // inverting
-					speed -= 10;
-					if (speed<10) speed = 10;
-					al_set_timer_speed(game.timer, ALLEGRO_BPS_TO_SECS(speed));
-					game.showconsole = true;
-					PrintConsole(&game, "DEBUG: Gameplay speed: %.2fx", speed/60.0);
-				}	else if ((game.debug) && (ev.type == ALLEGRO_EVENT_KEY_DOWN) && (ev.keyboard.keycode == ALLEGRO_KEY_F11)) {
-					double speed = ALLEGRO_BPS_TO_SECS(al_get_timer_speed(game.timer)); // inverting
-					speed += 10;
-					if (speed>600) speed = 600;
-					al_set_timer_speed(game.timer, ALLEGRO_BPS_TO_SECS(speed));
-					game.showconsole = true;
-					PrintConsole(&game, "DEBUG: Gameplay speed: %.2fx", speed/60.0);
-				} else if ((game.debug) && (ev.type == ALLEGRO_EVENT_KEY_DOWN) && (ev.keyboard.keycode == ALLEGRO_KEY_F12)) {
-					ALLEGRO_PATH *path = al_get_standard_path(ALLEGRO_USER_DOCUMENTS_PATH);
-					char filename[255] = { };
-					sprintf(filename, "SuperDerpy_%ld_%ld.png", time(NULL), clock());
-					al_set_path_filename(path, filename);
-					al_save_bitmap(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP), al_get_backbuffer(game.display));
-					PrintConsole(&game, "Screenshot stored in %s", al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
-					al_destroy_path(path);
+				if (quit) break;
+				if (ticks > LOGIC_MAX_BATCH) {
+					game.dropped_ticks += ticks - LOGIC_MAX_BATCH;
+					ticks = LOGIC_MAX_BATCH;
 				}
-				KEYDOWN_STATE(GAMESTATE_PAUSE, Pause)
-				KEYDOWN_STATE(GAMESTATE_MENU, Menu)
-				KEYDOWN_STATE(GAMESTATE_LOADING, Loading)
-				KEYDOWN_STATE(GAMESTATE_ABOUT, About)
-				KEYDOWN_STATE(GAMESTATE_INTRO, Intro)
-				KEYDOWN_STATE(GAMESTATE_MAP, Map)
-				KEYDOWN_STATE(GAMESTATE_LEVEL, Level)
-				KEYDOWN_STATE(GAMESTATE_DISCLAIMER, Disclaimer)
-				else {
-					game.showconsole = true;
-					PrintConsole(&game, "ERROR: Keystroke in unknown (%d) gamestate! (5 sec sleep)", game.gamestate);
-					DrawConsole(&game);
-					al_flip_display();
-					al_rest(5.0);
-					PrintConsole(&game, "Returning to menu...");
-					game.gamestate = GAMESTATE_LOADING;
-					game.loadstate = GAMESTATE_MENU;
-				}
-			} else if (game.gamestate == GAMESTATE_LEVEL) {
-				Level_ProcessEvent(&game, &ev);
-			}
+				while (ticks--) LogicGameState(&game);
+			} else if (HandleEvent(&ev)) break;
 		}
 	}
 	game.shuttingdown = true;
+	Pacer_Report(&game);
+	Pacer_Destroy(&game);
 	UnloadGameState(&game);
 	if (game.gamestate != GAMESTATE_LOADING) {
 		game.gamestate = GAMESTATE_LOADING;
@@ -678,7 +817,14 @@ int main(int argc, char **argv){
 	al_flip_display();
 	al_rest(0.1);
 	al_destroy_timer(game.timer);
+	Prefetch_Stop(&game);
 	Shared_Unload(&game);
+	/* cached assets outlive gamestates, so they go away only once all of them are unloaded */
+	Assets_Purge(&game, ASSET_BITMAP);
+	Assets_Purge(&game, ASSET_SOUND);
+	Transition_Destroy(&game);
+	Pool_Destroy(&game);
+	FreeDerpySpritesheets(&game);
 	al_destroy_display(game.display);
 	al_destroy_event_queue(game.event_queue);
 	al_destroy_mixer(game.audio.fx);
@@ -686,7 +832,10 @@ int main(int argc, char **argv){
 	al_destroy_mixer(game.audio.mixer);
 	al_destroy_voice(game.audio.v);
 	al_uninstall_audio();
+	Replay_Close(&game);
 	DeinitConfig();
+	Archive_Close();
+	Track_Report(NULL, NULL);
 	if (game.restart) {
 		al_shutdown_ttf_addon();
 		al_shutdown_font_addon();
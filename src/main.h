@@ -30,6 +30,7 @@
 #include <allegro5/allegro_font.h>
 #include <allegro5/allegro_ttf.h>
 #include "allegro_utils.h"
+#include "random.h"
 
 /*! \brief Declares variables used by displaying progress bar on loading screen.
  * Takes number of loading steps as parameter.
@@ -38,7 +39,18 @@
 /*! \brief Increments progress of loading. */
 #define PROGRESS if (progress) (*progress)(game, load_p+=1/load_a);
 
+/*! \brief Number of logic ticks per second. */
+#define LOGIC_FPS 60
+/*! \brief Maximal number of backlogged logic ticks run at once; ticks above it are dropped. */
+#define LOGIC_MAX_BATCH 5
+
 struct Game;
+struct Replay;
+struct Sound;
+struct Asset;
+struct PrefetchJob;
+struct TextEntry;
+struct PoolTarget;
 
 /*! \brief Enum of all available gamestates. */
 enum gamestate_enum {
@@ -49,7 +61,52 @@ enum gamestate_enum {
 	GAMESTATE_INTRO,
 	GAMESTATE_MAP,
 	GAMESTATE_LEVEL,
-	GAMESTATE_DISCLAIMER
+	GAMESTATE_DISCLAIMER,
+	GAMESTATE_COUNT
+};
+
+/*! \brief Maximum number of gamestates suspended below the current one. */
+#define GAMESTATE_STACK_SIZE 4
+
+/*! \brief Descriptor of gamestate, registered in gamestates table in main.c. */
+struct Gamestate {
+		char* name; /*!< Name used in console messages. */
+		void (*Preload)(struct Game*, void (*progress)(struct Game*, float)); /*!< Loads resources while loading screen is displayed. Optional, state can't be loaded by loading screen without it. */
+		void (*Load)(struct Game*); /*!< Makes state active. */
+		void (*Unload)(struct Game*); /*!< Frees resources of the state. */
+		void (*Stop)(struct Game*); /*!< Optional, called instead of Unload when state is left, but keeps its resources for later. */
+		void (*Draw)(struct Game*); /*!< Draws frame of the state. */
+		void (*Logic)(struct Game*); /*!< Optional, called on every logic tick while state is on top. */
+		int (*Keydown)(struct Game*, ALLEGRO_EVENT*); /*!< Handles key press, returns non-zero to quit the game. */
+		void (*ProcessEvent)(struct Game*, ALLEGRO_EVENT*); /*!< Optional, handles any other event. */
+		void (*Pause)(struct Game*); /*!< Optional, called when another state is pushed over this one. */
+		void (*Resume)(struct Game*); /*!< Optional, called when state becomes top of the stack again. */
+};
+
+/*! \brief Descriptor of level, registered in levels table in level.c. */
+struct LevelDescriptor {
+		void (*Preload)(struct Game*); /*!< Prepares level data, before bitmaps are loaded. */
+		void (*PreloadBitmaps)(struct Game*, void (*progress)(struct Game*, float)); /*!< Loads level bitmaps. */
+		void (*Prefetch)(struct Game*); /*!< Requests level specific bitmaps to be decoded in background. */
+		int (*PreloadSteps)(void); /*!< Returns number of progress steps made by PreloadBitmaps. */
+		void (*Load)(struct Game*); /*!< Starts the level. */
+		void (*Unload)(struct Game*); /*!< Frees level data. */
+		void (*UnloadBitmaps)(struct Game*); /*!< Frees level bitmaps. */
+		void (*Draw)(struct Game*); /*!< Draws level specific layers. */
+		void (*Logic)(struct Game*); /*!< Processes level logic. */
+		void (*Keydown)(struct Game*, ALLEGRO_EVENT*); /*!< Handles key press. */
+		void (*ProcessEvent)(struct Game*, ALLEGRO_EVENT*); /*!< Handles any other event. */
+		void (*Pause)(struct Game*); /*!< Pauses level. */
+		void (*Resume)(struct Game*); /*!< Resumes level. */
+};
+
+/*! \brief Bits of player input, sampled on every logic tick of the level. */
+enum input_enum {
+	INPUT_UP = 1,
+	INPUT_DOWN = 2,
+	INPUT_LEFT = 4,
+	INPUT_RIGHT = 8,
+	INPUT_ENTER = 16
 };
 
 /*! \brief Structure representing obstacles and power-ups flying through the level. */
@@ -75,18 +132,21 @@ struct Obstacle {
 		struct Obstacle *next; /*!< Next obstacle on the list. */
 };
 
-/*! \brief Structure representing one spritesheet animation of Derpy. */
+/*! \brief Structure representing one spritesheet animation of Derpy, as described in the manifest. */
 struct Spritesheet {
 		char* name; /*!< Readable name of the spritesheet. */
-		ALLEGRO_BITMAP* bitmap; /*!< Spritesheet bitmap. */
+		ALLEGRO_BITMAP* bitmap; /*!< Spritesheet bitmap, NULL unless it's used by current level. */
+		ALLEGRO_BITMAP* frame; /*!< Sub-bitmap of Level.derpy_frames sized to a single frame of the spritesheet. */
 		int rows; /*!< Number of rows in the spritesheet. */
 		int cols; /*!< Number of columns in the spritesheet. */
 		int blanks; /*!< Number of blank frames at the end of the spritesheet. */
 		float speed; /*!< Speed modifier of spritesheet animation. */
 		float aspect; /*!< Aspect ratio of the frame. */
 		float scale; /*!< Scale modifier of the frame. */
-		char* successor; /*!< Name of animation successor. If it's not blank, then animation will be played only once. */
-		struct Spritesheet* next; /*!< Next spritesheet in the queue. */
+		int successor; /*!< Handle of animation successor. If it's not -1, then animation will be played only once. */
+		bool registered; /*!< True if spritesheet is used by current level. */
+		bool requested; /*!< True if bitmap has been requested from prefetch worker and not taken yet. */
+		bool wanted; /*!< True if spritesheet is current or about to be selected by scheduled action. */
 };
 
 /* Gamestate structs */
@@ -94,6 +154,8 @@ struct Spritesheet {
 /*! \brief Resources used by Moonwalk level module. */
 struct Moonwalk {
 		double derpy_pos; /*!< Position of Derpy on screen. */
+		int sheet_walk; /*!< Handle of walking spritesheet. */
+		char title[64]; /*!< Text shown above Derpy, formatted on load. */
 };
 
 /*! \brief Resources used by Dodger level module. */
@@ -108,14 +170,20 @@ struct Dodger {
 				ALLEGRO_BITMAP *screwball; /*!< Screwball spritesheet bitmap. */
 		} obst_bmps; /*!< Obstacle bitmaps. */
 		struct Obstacle *obstacles; /*!< List of obstacles being currently rendered. */
+		int sheet_walk; /*!< Handle of walking spritesheet. */
+		int sheet_fly; /*!< Handle of flying spritesheet. */
+		int sheet_run; /*!< Handle of running spritesheet. */
 } dodger;
 
 /*! \brief Resources used by Level state and shared between level modules. */
 struct Level {
 		struct {
 			int current_level; /*!< Level number. */
+			unsigned int seed; /*!< Seed to use in the level, 0 to pick one from current time. */
+			unsigned char (*bot)(struct Game*); /*!< Scripted player returning input bits on every tick, used instead of keyboard if not NULL. */
 		} input; /*!< Gamestate input data. */
 		int current_level; /*!< Level number. */
+		struct LevelDescriptor *descriptor; /*!< Callbacks of current level. */
 		float speed; /*!< Speed of the player. */
 		float speed_modifier; /*!< Modifier of the speed of the player. */
 		float bg_pos; /*!< Position of the background layer of the scene. */
@@ -127,34 +195,42 @@ struct Level {
 		float derpy_angle; /*!< Angle of Derpy sprite on screen (radians). */
 		float hp; /*!< Player health points (0-1). */
 		bool handle_input; /*!< When false, player looses control over Derpy. */
+		unsigned char keys; /*!< Player input sampled in current logic tick (bits from input_enum). */
+		unsigned char keys_prev; /*!< Player input sampled in previous logic tick. */
+		unsigned int seed; /*!< Seed of random number generators used in the level. */
+		struct {
+				struct RNG obstacles; /*!< Stream used for spawning obstacles. */
+		} rng; /*!< Random number streams of level subsystems. */
 		bool failed; /*!< Indicates if player failed level. */
 		bool unloading; /*!< Indicated if level is already being unloaded. */
+		bool retry; /*!< Indicates if level is going to be restarted at the end of current logic tick. */
 		float meter_alpha; /*!< Alpha level of HP meter. */
 		int sheet_rows; /*!< Number of rows in current spritesheet. */
 		int sheet_cols; /*!< Number of cols in current spritesheet. */
 		int sheet_pos; /*!< Frame position in current spritesheet. */
 		int sheet_blanks; /*!< Number of blank frames at the end of current spritesheet. */
-		char* sheet_successor; /*!< Successor of current animation. If blank, then it's looped. */
+		int sheet; /*!< Handle of current spritesheet. */
+		int sheet_stand; /*!< Handle of default standing spritesheet. */
+		int sheet_successor; /*!< Handle of successor of current animation. If -1, then it's looped. */
 		float sheet_tmp; /*!< Temporary counter used to slow down spritesheet animation. */
 		float sheet_speed; /*!< Current speed of Derpy animation. */
 		float sheet_speed_modifier; /*!< Modifier of speed, specified by current spritesheet. */
 		float sheet_scale; /*!< Scale modifier of current spritesheet. */
 		ALLEGRO_FONT *letter_font; /*!< Font used in letter from Twilight on first level. */
-		ALLEGRO_SAMPLE *sample; /*!< Sample with background music. */
-		ALLEGRO_SAMPLE_INSTANCE *music; /*!< Sample instance with background music. */
-		unsigned int music_pos; /*!< Position of sample instance. Used when pausing game. */
+		ALLEGRO_AUDIO_STREAM *music; /*!< Audio stream with background music. */
 		ALLEGRO_BITMAP *background; /*!< Bitmap of the background layer of the scene. */
 		ALLEGRO_BITMAP *stage; /*!< Bitmap of the stage layer of the scene. */
 		ALLEGRO_BITMAP *foreground; /*!< Bitmap of the foreground layer of the scene. */
 		ALLEGRO_BITMAP *clouds; /*!< Bitmap of the clouds layer of the scene. */
 		ALLEGRO_BITMAP *welcome; /*!< Bitmap of the welcome text (for instance "Level 1: Fluttershy"). */
 		ALLEGRO_BITMAP **derpy_sheet; /*!< Pointer to active Derpy sprite sheet. */
-		ALLEGRO_BITMAP *derpy; /*!< Derpy sprite. */
+		ALLEGRO_BITMAP *derpy; /*!< Derpy sprite, frame of current spritesheet. */
+		ALLEGRO_BITMAP *derpy_frames; /*!< Bitmap holding frames of all registered spritesheets. */
 		ALLEGRO_BITMAP *meter_bmp; /*!< Bitmap of the HP meter. */
 		ALLEGRO_BITMAP *meter_image; /*!< Derpy image used in the HP meter. */
 		ALLEGRO_BITMAP *letter; /*!< Bitmap with letter from Twilight. */
 		bool debug_show_sprite_frames; /*!< When true, displays colorful borders around spritesheets and their active areas. */
-		struct Spritesheet* derpy_sheets; /*!< List of spritesheets of Derpy character. */
+		bool debug_show_timeline; /*!< When true, displays timeline inspector with state and cost of every action. */
 		//struct Spritesheet* pony_sheets; /*!< List of spritesheets of character rescued by Derpy. */
 		struct {
 				ALLEGRO_BITMAP *owl; /*!< Owlicious bitmap. */
@@ -193,12 +269,11 @@ struct Menu {
 		float cloud_position; /*!< Position of bigger cloud. */
 		float cloud2_position; /*!< Position of small cloud. */
 		int mountain_position; /*!< Position of flashing mountain. */
-		ALLEGRO_SAMPLE *sample; /*!< Background music sample. */
-		ALLEGRO_SAMPLE *rain_sample; /*!< Rain sound sample. */
-		ALLEGRO_SAMPLE *click_sample; /*!< Click sound sample. */
-		ALLEGRO_SAMPLE_INSTANCE *music; /*!< Sample instance with background music. */
+		struct RNG rng; /*!< Random number stream used for menu effects. */
+		struct Sound *rain_sample; /*!< Rain sound. */
+		ALLEGRO_AUDIO_STREAM *music; /*!< Audio stream with background music. */
 		ALLEGRO_SAMPLE_INSTANCE *rain_sound; /*!< Sample instance with rain sound. */
-		ALLEGRO_SAMPLE_INSTANCE *click; /*!< Sample instance with click sound. */
+		struct Sound *click; /*!< Click sound. */
 		ALLEGRO_FONT *font_title; /*!< Font of "Super Derpy" text. */
 		ALLEGRO_FONT *font_subtitle; /*!< Font of "Muffin Attack" text. */
 		ALLEGRO_FONT *font; /*!< Font of standard menu item. */
@@ -206,6 +281,7 @@ struct Menu {
 		int selected; /*!< Number of selected menu item. */
 		enum menustate_enum menustate; /*!< Current menu page. */
 		bool loaded; /*!< True if Menu state has been already loaded. */
+		char labels[3][32]; /*!< Labels of audio volume items, formatted when volumes change. */
 		struct {
 				bool fullscreen;
 				int fps;
@@ -218,22 +294,41 @@ struct Menu {
 struct Loading {
 		ALLEGRO_BITMAP *loading_bitmap; /*!< Rendered loading bitmap. */
 		ALLEGRO_BITMAP *image; /*!< Loading background. */
+		bool started; /*!< True once loading screen has started fading in. */
+		bool preloaded; /*!< True once the next gamestate has been preloaded. */
+		double last; /*!< Time of the last transition tick made while preloading. */
+		float progress; /*!< Progress of preloading (0-1). */
 };
 
 /*! \brief Resources used by Pause state. */
 struct Pause {
-		ALLEGRO_BITMAP *bitmap; /*!< Bitmap with screenshot. */
 		ALLEGRO_BITMAP *derpy; /*!< Derpy on foreground. */
 };
 
+/*! \brief Number of strips in the ring of rasterised credits. */
+#define ABOUT_STRIPS 5
+
+/*! \brief Line of credits, laid out once on preload. */
+struct AboutLine {
+		char* text; /*!< Text of the line. */
+		float x; /*!< Horizontal anchor of the line, in pixels. */
+		float y; /*!< Top of the line, in pixels from the top of credits. */
+		int align; /*!< Allegro text alignment flags. */
+};
+
 /*! \brief Resources used by About state. */
 struct About {
 		ALLEGRO_BITMAP *fade_bitmap; /*!< Bitmap with screenshot, used in fades. */
 		ALLEGRO_BITMAP *image; /*!< Background bitmap. */
-		ALLEGRO_BITMAP *text_bitmap; /*!< Bitmap with scrolled text. */
+		struct AboutLine *lines; /*!< Credits laid out in text coordinates. */
+		int line_count; /*!< Number of lines of credits. */
+		int text_width; /*!< Width of credits, in pixels. */
+		int text_height; /*!< Height of credits, in pixels. */
+		int strip_height; /*!< Height of part of credits held by each strip. */
+		ALLEGRO_BITMAP *strips[ABOUT_STRIPS]; /*!< Ring of bitmaps with rasterised parts of credits, refilled while they scroll. */
+		int strip_index[ABOUT_STRIPS]; /*!< Number of part of credits held by each strip, -1 if it's empty. */
 		ALLEGRO_BITMAP *letter; /*!< Paper bitmap. */
-		ALLEGRO_SAMPLE *sample; /*!< Sample with background music. */
-		ALLEGRO_SAMPLE_INSTANCE *music; /*!< Sample instance with background music. */
+		ALLEGRO_AUDIO_STREAM *music; /*!< Audio stream with background music. */
 		ALLEGRO_FONT *font; /*!< Font used in the text on letter. */
 		float x; /*!< Horizontal position of the text. */
 		int fadeloop; /*!< Loop counter used in fades. */
@@ -248,10 +343,8 @@ struct Map {
 		int selected; /*!< Number of currently selected level. */
 		int available; /*!< Number of highest available level. */
 		float arrowpos; /*!< Vertical position of the arrow. */
-		ALLEGRO_SAMPLE *sample; /*!< Sample with backgrond music. */
-		ALLEGRO_SAMPLE *click_sample; /*!< Sample with click sound. */
-		ALLEGRO_SAMPLE_INSTANCE *music; /*!< Sample instance with background music. */
-		ALLEGRO_SAMPLE_INSTANCE *click; /*!< Sample instance with click sound. */
+		ALLEGRO_AUDIO_STREAM *music; /*!< Audio stream with background music. */
+		struct Sound *click; /*!< Click sound. */
 };
 
 /*! \brief Resources used by Intro state. */
@@ -261,13 +354,18 @@ struct Intro {
 		bool in_animation; /*!< Animation as in page transition animation. */
 		float anim; /*!< Counter used for spritesheet animations. */
 		ALLEGRO_BITMAP *table; /*!< Background paper bitmap, two pages long. */
+		ALLEGRO_BITMAP *next_table; /*!< Paper bitmap shown after next page turn, rendered ahead of time. */
+		int next_page; /*!< Number of page on the left side of next_table. */
+		int next_rendered; /*!< Number of pages already rendered into next_table. */
 		ALLEGRO_BITMAP *table_bitmap; /*!< Unscaled background paper bitmap. */
 		ALLEGRO_BITMAP *frame; /*!< Bitmap with frame around the screen. */
 		ALLEGRO_BITMAP *animsprites[5]; /*!< Array with spritesheet bitmaps. */
 		ALLEGRO_FONT *font; /*!< Font used for text. */
-		ALLEGRO_SAMPLE *sample; /*!< Background music sample. */
-		ALLEGRO_SAMPLE_INSTANCE *music; /*!< Sample instance with background music. */
+		ALLEGRO_AUDIO_STREAM *music; /*!< Audio stream with background music. */
 		ALLEGRO_AUDIO_STREAM *audiostream; /*!< Audiostream used for Celestia voice. */
+		ALLEGRO_AUDIO_STREAM *next_stream; /*!< Celestia voice for next page, opened in background. */
+		ALLEGRO_THREAD *stream_thread; /*!< Thread opening next_stream. */
+		int stream_page; /*!< Number of page which voice is opened by stream_thread. */
 };
 
 /*! \brief Main struct of the game. */
@@ -277,6 +375,8 @@ struct Game {
 		ALLEGRO_FONT *font_console; /*!< Font used in game console. */
 		enum gamestate_enum gamestate; /*!< Current game state. */
 		enum gamestate_enum loadstate; /*!< Game state to be loaded. */
+		enum gamestate_enum stack[GAMESTATE_STACK_SIZE]; /*!< Game states suspended below the current one, bottom first. */
+		int stack_depth; /*!< Number of suspended game states. */
 		ALLEGRO_EVENT_QUEUE *event_queue; /*!< Main event queue. */
 		ALLEGRO_TIMER *timer; /*!< Main FPS timer. */
 		ALLEGRO_BITMAP *console; /*!< Bitmap with game console. */
@@ -288,11 +388,63 @@ struct Game {
 		int voice; /*!< Voice volume. */
 		bool fullscreen; /*!< Fullscreen toggle. */
 		bool debug; /*!< Toggles debug mode. */
-		int fps; /*!< FPS limit */
+		int fps; /*!< FPS limit, 0 to follow display refresh rate. */
 		int width; /*!< Width of window as being set in configuration. */
 		int height; /*!< Height of window as being set in configuration. */
 		bool shuttingdown; /*!< If true then shut down of the game is pending. */
 		bool restart; /*!< If true then restart of the game is pending. */
+		unsigned int dropped_ticks; /*!< Number of backlogged logic ticks dropped, as there were more than LOGIC_MAX_BATCH of them. */
+		struct Replay *replay; /*!< Replay being recorded or played back, NULL if none. */
+		struct {
+				struct Asset *list; /*!< List of loaded assets. */
+				size_t size; /*!< Estimated footprint of all loaded assets, in bytes. */
+				size_t budget; /*!< Footprint above which unreferenced assets are evicted, in bytes. */
+				unsigned long clock; /*!< Counter of asset requests, used to find least recently used ones. */
+		} assets; /*!< Assets shared between gamestates. */
+		struct {
+				ALLEGRO_THREAD *thread; /*!< Worker decoding queued bitmaps, NULL when not started. */
+				ALLEGRO_MUTEX *mutex; /*!< Mutex guarding the job list. */
+				ALLEGRO_COND *cond; /*!< Signalled when a job is queued or finished. */
+				struct PrefetchJob *jobs; /*!< Queued and decoded bitmaps, in order of priority. */
+		} prefetch; /*!< Bitmaps decoded in background before they're needed. */
+		struct {
+				ALLEGRO_BITMAP *atlas; /*!< Bitmap with rendered texts. */
+				struct TextEntry *entries; /*!< Texts rendered into the atlas. */
+				int count; /*!< Number of rendered texts. */
+				int shelf_x; /*!< Horizontal position of free space on current shelf of the atlas. */
+				int shelf_y; /*!< Vertical position of current shelf of the atlas. */
+				int shelf_height; /*!< Height of the highest cell on current shelf. */
+		} text; /*!< Cache of rendered texts. */
+		struct {
+				struct Spritesheet *list; /*!< Spritesheets of Derpy, indexed by their handles. */
+				int count; /*!< Number of spritesheets in the manifest. */
+		} spritesheets; /*!< Manifest of Derpy animations, loaded on first use. */
+		struct {
+				ALLEGRO_TIMER *timer; /*!< Timer ticking when next frame is due, NULL if frames aren't paced. */
+				double interval; /*!< Intended time between frames, in seconds. */
+				bool due; /*!< True if frame timer has ticked since the last frame. */
+				bool dirty; /*!< True if any event has been handled since the last frame. */
+				double last; /*!< Time of the last flip. */
+				unsigned int frames; /*!< Number of measured frame intervals. */
+				unsigned int skipped; /*!< Number of due frames skipped, as nothing has changed. */
+				unsigned int skipped_last; /*!< Value of skipped at the last flip. */
+				double error_sum; /*!< Sum of absolute deviations of frame intervals from intended ones. */
+				double error_sq_sum; /*!< Sum of squared deviations of frame intervals. */
+				double error_worst; /*!< Largest deviation of frame interval. */
+		} pacer; /*!< Frame pacing state and jitter statistics. */
+		struct {
+				ALLEGRO_BITMAP *snapshot; /*!< Pooled offscreen target with last frame of leaving gamestate, NULL when no transition is in progress. */
+				int mode; /*!< Kind of transition in progress, from transition_enum. */
+				float t; /*!< Progress of current transition (0-1). */
+				float snapshot_weight; /*!< Share of the snapshot on screen when fade in started. */
+				float black_weight; /*!< Share of black cover on screen when fade in started. */
+		} transition; /*!< Transition between gamestates, driven by the main loop. */
+		struct {
+				struct PoolTarget *list; /*!< Targets owned by the pool, both acquired and idle. */
+				unsigned int created; /*!< Number of targets created since the game was started. */
+				unsigned int acquired; /*!< Number of acquisitions. */
+				unsigned int hits; /*!< Number of acquisitions served with idle target. */
+		} pool; /*!< Pool of offscreen render targets. */
 		struct Menu menu; /*!< Resources used by Menu state. */
 		struct Loading loading; /*!< Resources used by Menu state. */
 		struct Intro intro; /*!< Resources used by Intro state. */
@@ -312,21 +464,27 @@ struct Game {
 /*! \brief Preloads gamestate set in game->loadstate. */
 void PreloadGameState(struct Game *game, void (*progress)(struct Game*, float));
 
-/*! \brief Unloads gamestate set in game->gamestate. */
+/*! \brief Unloads gamestate set in game->gamestate, together with all states suspended below it. */
 void UnloadGameState(struct Game *game);
 
 /*! \brief Loads gamestate set in game->loadstate. */
 void LoadGameState(struct Game *game);
 
-/*! \brief Pauses gamestate set in game->loadstate. */
-void PauseGameState(struct Game *game);
+/*! \brief Pauses current gamestate and loads given one over it. */
+void PushGameState(struct Game *game, enum gamestate_enum state);
 
-/*! \brief Resumes gamestate set in game->loadstate. */
-void ResumeGameState(struct Game *game);
+/*! \brief Unloads current gamestate and resumes the one suspended below it. */
+void PopGameState(struct Game *game);
+
+/*! \brief Returns descriptor of given gamestate, or NULL if there's no such state. */
+struct Gamestate* GetGameState(enum gamestate_enum state);
 
 /*! \brief Finds path for data file. */
 char* GetDataFilePath(char* filename);
 
+/*! \brief Finds path for data file, returning NULL instead of quitting if it doesn't exist. */
+char* FindDataFilePath(char* filename);
+
 /*! \brief Print some message on game console.
  *
  * Draws message on console bitmap, so it'll be displayed when calling DrawConsole.
@@ -338,16 +496,22 @@ void PrintConsole(struct Game *game, char* format, ...);
 /*! \brief Draws console bitmap on screen. */
 void DrawConsole(struct Game *game);
 
-/*! \brief Loads bitmap into memory and scales it with software linear filtering. */
+/*! \brief Loads bitmap scaled to given size, from baked texture if there is one for this size. */
 ALLEGRO_BITMAP* LoadScaledBitmap(char* filename, int width, int height);
 
-/*! \brief Draws frame from current gamestate. */
+/*! \brief Opens music file as looping audio stream attached to music mixer, stopped until played. */
+ALLEGRO_AUDIO_STREAM* LoadMusic(struct Game *game, char* filename);
+
+/*! \brief Stops music and rewinds it to the beginning. */
+void StopMusic(ALLEGRO_AUDIO_STREAM *music);
+
+/*! \brief Draws frame from current gamestate, over all states suspended below it. */
 void DrawGameState(struct Game *game);
 
 /*! \brief Processes logic of current gamestate. */
 void LogicGameState(struct Game *game);
 
-/*! \brief Displays fade in or fade out animation on current gamestate. */
+/*! \brief Starts fade in or fade out of current gamestate. Returns right away; fade is drawn by the main loop. */
 void FadeGameState(struct Game *game, bool in);
 
 /*! \brief Load shared resources. */
@@ -359,4 +523,6 @@ void Shared_Unload(struct Game *game);
 /*! \brief Setups letterbox viewport if necessary. */
 void SetupViewport(struct Game *game);
 
+#include "track.h"
+
 #endif
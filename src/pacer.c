@@ -0,0 +1,90 @@
+/*! \file pacer.c
+ *  \brief Frame pacing code.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include <math.h>
+#include "pacer.h"
+
+void Pacer_Init(struct Game *game) {
+	int fps = game->fps;
+	if (fps <= 0) fps = al_get_display_refresh_rate(game->display);
+	if (fps <= 0) fps = PACER_DEFAULT_FPS;
+	memset(&game->pacer, 0, sizeof(game->pacer));
+	game->pacer.interval = 1.0 / fps;
+	game->pacer.dirty = true;
+	game->pacer.timer = al_create_timer(game->pacer.interval);
+	if (!game->pacer.timer) {
+		/* without frame timer every frame is due, as it used to be */
+		PrintConsole(game, "Pacer: failed to create frame timer, frames won't be paced.");
+		return;
+	}
+	al_register_event_source(game->event_queue, al_get_timer_event_source(game->pacer.timer));
+	al_start_timer(game->pacer.timer);
+	PrintConsole(game, "Pacer: %d frames per second", fps);
+}
+
+bool Pacer_Event(struct Game *game, ALLEGRO_EVENT *ev) {
+	if ((ev->type == ALLEGRO_EVENT_TIMER) && (game->pacer.timer) && (ev->timer.source == game->pacer.timer)) {
+		game->pacer.due = true;
+		return true;
+	}
+	/* game state changes only in response to events */
+	game->pacer.dirty = true;
+	return false;
+}
+
+bool Pacer_Due(struct Game *game) {
+	if (!game->pacer.timer) return true;
+	if (!game->pacer.due) return false;
+	if (!game->pacer.dirty) {
+		game->pacer.due = false;
+		game->pacer.skipped++;
+		return false;
+	}
+	return true;
+}
+
+void Pacer_Flipped(struct Game *game) {
+	double now = al_get_time();
+	if (game->pacer.last) {
+		/* deviation from the intended interval, skipped frames count as intended pauses */
+		double interval = now - game->pacer.last;
+		double error = interval - game->pacer.interval * (1 + game->pacer.skipped - game->pacer.skipped_last);
+		game->pacer.frames++;
+		game->pacer.error_sum += fabs(error);
+		game->pacer.error_sq_sum += error * error;
+		if (fabs(error) > game->pacer.error_worst) game->pacer.error_worst = fabs(error);
+	}
+	game->pacer.last = now;
+	game->pacer.skipped_last = game->pacer.skipped;
+	game->pacer.due = false;
+	game->pacer.dirty = false;
+}
+
+void Pacer_Report(struct Game *game) {
+	if (!game->pacer.frames) return;
+	PrintConsole(game, "Pacer: %u frames, %u skipped, %u logic ticks dropped, jitter %.2f ms mean, %.2f ms RMS, %.2f ms worst", game->pacer.frames, game->pacer.skipped, game->dropped_ticks, game->pacer.error_sum / game->pacer.frames * 1000, sqrt(game->pacer.error_sq_sum / game->pacer.frames) * 1000, game->pacer.error_worst * 1000);
+}
+
+void Pacer_Destroy(struct Game *game) {
+	if (!game->pacer.timer) return;
+	al_destroy_timer(game->pacer.timer);
+	game->pacer.timer = NULL;
+}
@@ -0,0 +1,42 @@
+/*! \file pacer.h
+ *  \brief Frame pacing headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef PACER_H
+#define PACER_H
+
+#include "main.h"
+
+/*! \brief Frame rate used when neither fps option nor display tells the refresh rate. */
+#define PACER_DEFAULT_FPS 60
+
+/*! \brief Starts frame timer at fps set in configuration, or at display refresh rate if it's 0. */
+void Pacer_Init(struct Game *game);
+/*! \brief Handles event taken from the queue. Returns true if it was a frame tick, which needs no further handling. */
+bool Pacer_Event(struct Game *game, ALLEGRO_EVENT *ev);
+/*! \brief Checks if frame is due and something has changed since the last one was drawn. */
+bool Pacer_Due(struct Game *game);
+/*! \brief Records frame which has just been flipped. */
+void Pacer_Flipped(struct Game *game);
+/*! \brief Prints pacing statistics gathered since the game was started. */
+void Pacer_Report(struct Game *game);
+/*! \brief Stops and destroys frame timer. */
+void Pacer_Destroy(struct Game *game);
+
+#endif
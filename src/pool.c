@@ -0,0 +1,123 @@
+/*! \file pool.c
+ *  \brief Pool of offscreen render targets.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "pool.h"
+
+/*! \brief Destroys target pointed to by given link and unlinks it. */
+void PoolDestroyTarget(struct PoolTarget **link) {
+	struct PoolTarget *target = *link;
+	*link = target->next;
+	al_destroy_bitmap(target->bitmap);
+	free(target);
+}
+
+ALLEGRO_BITMAP* Pool_Acquire(struct Game *game, int width, int height) {
+	int format = al_get_new_bitmap_format(), flags = al_get_new_bitmap_flags();
+	game->pool.acquired++;
+	struct PoolTarget *target = game->pool.list;
+	while (target) {
+		if ((!target->busy) && (target->width == width) && (target->height == height) && (target->format == format) && (target->flags == flags)) {
+			target->busy = true;
+			game->pool.hits++;
+			return target->bitmap;
+		}
+		target = target->next;
+	}
+	ALLEGRO_BITMAP *bitmap = al_create_bitmap(width, height);
+	if (!bitmap) return NULL;
+	target = malloc(sizeof(struct PoolTarget));
+	target->bitmap = bitmap;
+	target->width = width;
+	target->height = height;
+	target->format = format;
+	target->flags = flags;
+	target->busy = true;
+	target->next = game->pool.list;
+	game->pool.list = target;
+	game->pool.created++;
+	/* targets outlive the gamestate which asked for them first */
+	Track_Retag(target, "pool");
+	Track_Retag(bitmap, "pool");
+	return bitmap;
+}
+
+void Pool_Release(struct Game *game, ALLEGRO_BITMAP *bitmap) {
+	if (!bitmap) return;
+	struct PoolTarget **link = &game->pool.list;
+	while ((*link) && ((*link)->bitmap != bitmap)) link = &(*link)->next;
+	if (!(*link)) {
+		fprintf(stderr, "Pool: released bitmap %p doesn't belong to the pool!\n", (void*)bitmap);
+		return;
+	}
+	/* move to the front, so idle targets stay ordered by release time */
+	struct PoolTarget *target = *link;
+	*link = target->next;
+	target->busy = false;
+	target->next = game->pool.list;
+	game->pool.list = target;
+
+	int idle = 0;
+	link = &game->pool.list;
+	while (*link) {
+		if ((!(*link)->busy) && (++idle > POOL_MAX_IDLE)) {
+			PoolDestroyTarget(link);
+			continue;
+		}
+		link = &(*link)->next;
+	}
+}
+
+void Pool_Use(struct Game *game, int width, int height, void (*fn)(struct Game*, ALLEGRO_BITMAP*)) {
+	ALLEGRO_BITMAP *bitmap = Pool_Acquire(game, width, height);
+	if (!bitmap) return;
+	(*fn)(game, bitmap);
+	Pool_Release(game, bitmap);
+}
+
+void Pool_Purge(struct Game *game) {
+	struct PoolTarget **link = &game->pool.list;
+	while (*link) {
+		if (!(*link)->busy) PoolDestroyTarget(link);
+		else link = &(*link)->next;
+	}
+}
+
+void Pool_Dump(struct Game *game) {
+	/* console output goes through the pool as well, so numbers are taken first */
+	int count = 0, busy = 0;
+	size_t size = 0;
+	struct PoolTarget *target = game->pool.list;
+	while (target) {
+		count++;
+		if (target->busy) busy++;
+		size += (size_t)target->width*target->height*4;
+		target = target->next;
+	}
+	unsigned int created = game->pool.created, acquired = game->pool.acquired, hits = game->pool.hits;
+	PrintConsole(game, "Pool: %d targets (%d in use, %zu kB), %u created, %u acquired, %.1f%% hit rate", count, busy, size/1024, created, acquired, acquired ? hits*100.0/acquired : 0.0);
+}
+
+void Pool_Destroy(struct Game *game) {
+	while (game->pool.list) {
+		if (game->pool.list->busy) fprintf(stderr, "Pool: %dx%d target still in use!\n", game->pool.list->width, game->pool.list->height);
+		PoolDestroyTarget(&game->pool.list);
+	}
+}
@@ -0,0 +1,57 @@
+/*! \file pool.h
+ *  \brief Pool of offscreen render targets headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef POOL_H
+#define POOL_H
+
+#include "main.h"
+
+/*! \brief Number of idle targets kept for reuse. Least recently released ones beyond that are destroyed. */
+#define POOL_MAX_IDLE 4
+
+/*! \brief Offscreen target owned by the pool, identified by its size, format and flags. */
+struct PoolTarget {
+		ALLEGRO_BITMAP *bitmap; /*!< Target itself. */
+		int width; /*!< Width of the target. */
+		int height; /*!< Height of the target. */
+		int format; /*!< Pixel format the target was created with. */
+		int flags; /*!< Bitmap flags the target was created with. */
+		bool busy; /*!< True if target is acquired by someone. */
+		struct PoolTarget *next; /*!< Pointer to next target, idle ones ordered from most recently released. */
+};
+
+/*! \brief Returns offscreen target of given size, matching current new bitmap format and flags.
+ *
+ * Idle target released earlier is reused if there's one, otherwise new one is created.
+ * Contents of reused target are left as they were, so caller has to clear it if it doesn't draw over all of it.
+ */
+ALLEGRO_BITMAP* Pool_Acquire(struct Game *game, int width, int height);
+/*! \brief Gives target acquired with Pool_Acquire back to the pool. NULL is ignored. */
+void Pool_Release(struct Game *game, ALLEGRO_BITMAP *bitmap);
+/*! \brief Acquires target, calls given function with it and releases it right after. */
+void Pool_Use(struct Game *game, int width, int height, void (*fn)(struct Game*, ALLEGRO_BITMAP*));
+/*! \brief Destroys idle targets, e.g. when viewport size changes and they won't match anymore. */
+void Pool_Purge(struct Game *game);
+/*! \brief Prints number of targets, creations and hit rate on game console. */
+void Pool_Dump(struct Game *game);
+/*! \brief Destroys all targets. Those still acquired are reported as leaked. */
+void Pool_Destroy(struct Game *game);
+
+#endif
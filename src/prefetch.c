@@ -0,0 +1,208 @@
+/*! \file prefetch.c
+ *  \brief Background decoding of bitmaps.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "archive.h"
+#include "prefetch.h"
+
+/*! \brief Frees job together with its decoded bitmap. */
+void FreeJob(struct PrefetchJob *job) {
+	if (job->bitmap) al_destroy_bitmap(job->bitmap);
+	free(job->filename);
+	free(job);
+}
+
+/*! \brief Unlinks and frees stale jobs which aren't being decoded. Needs mutex to be locked. */
+void DropStaleJobs(struct Game *game) {
+	struct PrefetchJob **ptr = &game->prefetch.jobs;
+	while (*ptr) {
+		struct PrefetchJob *job = *ptr;
+		if ((job->stale) && (!job->busy)) {
+			*ptr = job->next;
+			FreeJob(job);
+		} else {
+			ptr = &job->next;
+		}
+	}
+}
+
+/*! \brief Finds wanted job for given bitmap, returning pointer to the link pointing at it. Needs mutex to be locked. */
+struct PrefetchJob** FindJob(struct Game *game, char* filename, int width, int height) {
+	struct PrefetchJob **ptr = &game->prefetch.jobs;
+	while (*ptr) {
+		struct PrefetchJob *job = *ptr;
+		if ((!job->stale) && (!strcmp(job->filename, filename)) && (job->width == width) && (job->height == height)) break;
+		ptr = &job->next;
+	}
+	return ptr;
+}
+
+/*! \brief Decodes queued bitmaps in order of priority, until asked to stop. */
+void* PrefetchThread(ALLEGRO_THREAD *thread, void *arg) {
+	struct Game *game = arg;
+	Archive_UseFileInterface();
+	Track_SetTag("prefetch");
+	al_lock_mutex(game->prefetch.mutex);
+	while (!al_get_thread_should_stop(thread)) {
+		struct PrefetchJob *job = game->prefetch.jobs;
+		while ((job) && ((job->done) || (job->busy) || (job->stale))) job = job->next;
+		if (!job) {
+			al_wait_cond(game->prefetch.cond, game->prefetch.mutex);
+			continue;
+		}
+		job->busy = true;
+		al_unlock_mutex(game->prefetch.mutex);
+
+		/* there's no display in this thread, so everything is decoded and scaled in memory */
+		al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+		ALLEGRO_BITMAP *bitmap = LoadScaledBitmap(job->filename, job->width, job->height);
+
+		al_lock_mutex(game->prefetch.mutex);
+		job->bitmap = bitmap;
+		job->done = true;
+		job->busy = false;
+		if (job->stale) DropStaleJobs(game);
+		al_broadcast_cond(game->prefetch.cond);
+	}
+	al_unlock_mutex(game->prefetch.mutex);
+	return NULL;
+}
+
+void Prefetch_Init(struct Game *game) {
+	game->prefetch.jobs = NULL;
+	game->prefetch.mutex = al_create_mutex();
+	game->prefetch.cond = al_create_cond();
+	game->prefetch.thread = al_create_thread(PrefetchThread, game);
+	if (game->prefetch.thread) al_start_thread(game->prefetch.thread);
+	else PrintConsole(game, "Prefetch: failed to start worker thread, bitmaps will be loaded on demand.");
+}
+
+void Prefetch_Begin(struct Game *game) {
+	if (!game->prefetch.thread) return;
+	al_lock_mutex(game->prefetch.mutex);
+	struct PrefetchJob *job = game->prefetch.jobs;
+	while (job) {
+		job->stale = true;
+		job = job->next;
+	}
+	al_unlock_mutex(game->prefetch.mutex);
+}
+
+void Prefetch_Bitmap(struct Game *game, char* filename, int width, int height) {
+	if (!game->prefetch.thread) return;
+	al_lock_mutex(game->prefetch.mutex);
+	struct PrefetchJob *job = NULL, **ptr = &game->prefetch.jobs;
+	while (*ptr) {
+		if ((!job) && (!strcmp((*ptr)->filename, filename)) && ((*ptr)->width == width) && ((*ptr)->height == height)) {
+			job = *ptr;
+			*ptr = job->next;
+			continue;
+		}
+		ptr = &(*ptr)->next;
+	}
+	if (!job) {
+		job = calloc(1, sizeof(struct PrefetchJob));
+		job->filename = strdup(filename);
+		job->width = width;
+		job->height = height;
+		/* queue outlives the gamestate which filled it */
+		Track_Retag(job, "prefetch");
+		Track_Retag(job->filename, "prefetch");
+	}
+	job->stale = false;
+	job->next = NULL;
+	*ptr = job;
+	al_unlock_mutex(game->prefetch.mutex);
+}
+
+void Prefetch_End(struct Game *game) {
+	if (!game->prefetch.thread) return;
+	al_lock_mutex(game->prefetch.mutex);
+	DropStaleJobs(game);
+	al_broadcast_cond(game->prefetch.cond);
+	al_unlock_mutex(game->prefetch.mutex);
+}
+
+void Prefetch_Cancel(struct Game *game) {
+	Prefetch_Begin(game);
+	Prefetch_End(game);
+}
+
+bool Prefetch_Ready(struct Game *game, char* filename, int width, int height) {
+	if (!game->prefetch.thread) return false;
+	al_lock_mutex(game->prefetch.mutex);
+	struct PrefetchJob *job = *FindJob(game, filename, width, height);
+	bool ready = (job) && (job->done);
+	al_unlock_mutex(game->prefetch.mutex);
+	return ready;
+}
+
+void Prefetch_Forget(struct Game *game, char* filename, int width, int height) {
+	if (!game->prefetch.thread) return;
+	al_lock_mutex(game->prefetch.mutex);
+	struct PrefetchJob *job = *FindJob(game, filename, width, height);
+	if (job) {
+		job->stale = true;
+		DropStaleJobs(game);
+	}
+	al_unlock_mutex(game->prefetch.mutex);
+}
+
+ALLEGRO_BITMAP* Prefetch_LoadBitmap(struct Game *game, char* filename, int width, int height) {
+	if (!game->prefetch.thread) return LoadScaledBitmap(filename, width, height);
+	al_lock_mutex(game->prefetch.mutex);
+	struct PrefetchJob *job, **ptr = FindJob(game, filename, width, height);
+	if (!(job = *ptr)) {
+		al_unlock_mutex(game->prefetch.mutex);
+		return LoadScaledBitmap(filename, width, height);
+	}
+	/* it's needed right now, so it goes to the front of the queue */
+	*ptr = job->next;
+	job->next = game->prefetch.jobs;
+	game->prefetch.jobs = job;
+	al_broadcast_cond(game->prefetch.cond);
+	while (!job->done) al_wait_cond(game->prefetch.cond, game->prefetch.mutex);
+	game->prefetch.jobs = job->next;
+	al_unlock_mutex(game->prefetch.mutex);
+
+	/* upload decoded bitmap into video memory, using flags of the caller */
+	ALLEGRO_BITMAP *bitmap = job->bitmap ? al_clone_bitmap(job->bitmap) : NULL;
+	FreeJob(job);
+	if (!bitmap) return LoadScaledBitmap(filename, width, height);
+	return bitmap;
+}
+
+void Prefetch_Stop(struct Game *game) {
+	if (game->prefetch.thread) {
+		al_lock_mutex(game->prefetch.mutex);
+		al_set_thread_should_stop(game->prefetch.thread);
+		al_broadcast_cond(game->prefetch.cond);
+		al_unlock_mutex(game->prefetch.mutex);
+		al_destroy_thread(game->prefetch.thread);
+		game->prefetch.thread = NULL;
+	}
+	while (game->prefetch.jobs) {
+		struct PrefetchJob *job = game->prefetch.jobs;
+		game->prefetch.jobs = job->next;
+		FreeJob(job);
+	}
+	al_destroy_cond(game->prefetch.cond);
+	al_destroy_mutex(game->prefetch.mutex);
+}
@@ -0,0 +1,57 @@
+/*! \file prefetch.h
+ *  \brief Background decoding of bitmaps headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include "main.h"
+
+/*! \brief Bitmap requested ahead of time, decoded by prefetch worker into memory bitmap. */
+struct PrefetchJob {
+		char* filename; /*!< Data file to load. */
+		int width; /*!< Requested width. */
+		int height; /*!< Requested height. */
+		ALLEGRO_BITMAP *bitmap; /*!< Decoded memory bitmap. */
+		bool done; /*!< True when worker is done with it. */
+		bool busy; /*!< True while worker decodes it. */
+		bool stale; /*!< True if it's not wanted anymore. Worker frees stale jobs as soon as it's done with them. */
+		struct PrefetchJob *next; /*!< Pointer to next job. */
+};
+
+/*! \brief Starts prefetch worker. */
+void Prefetch_Init(struct Game *game);
+/*! \brief Marks all queued bitmaps as unwanted, before new set is requested with Prefetch_Bitmap. */
+void Prefetch_Begin(struct Game *game);
+/*! \brief Requests bitmap; if it's already queued, it's kept and moved behind previously requested ones. */
+void Prefetch_Bitmap(struct Game *game, char* filename, int width, int height);
+/*! \brief Drops bitmaps which weren't requested again since Prefetch_Begin and wakes the worker. */
+void Prefetch_End(struct Game *game);
+/*! \brief Drops all queued and decoded bitmaps. */
+void Prefetch_Cancel(struct Game *game);
+/*! \brief Checks if requested bitmap has been decoded already, so taking it won't wait. */
+bool Prefetch_Ready(struct Game *game, char* filename, int width, int height);
+/*! \brief Drops single requested bitmap which isn't wanted anymore. */
+void Prefetch_Forget(struct Game *game, char* filename, int width, int height);
+/*! \brief Returns scaled bitmap, taken from prefetched ones (waiting for it if needed) or loaded right away. */
+ALLEGRO_BITMAP* Prefetch_LoadBitmap(struct Game *game, char* filename, int width, int height);
+/*! \brief Stops prefetch worker and frees everything it has decoded. */
+void Prefetch_Stop(struct Game *game);
+
+#endif
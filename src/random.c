@@ -0,0 +1,48 @@
+/*! \file random.c
+ *  \brief Seedable random number generator code.
+ *
+ *  PCG32 (XSH RR variant) by Melissa O'Neill, see http://www.pcg-random.org/
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include "random.h"
+
+void RNG_Seed(struct RNG *rng, uint64_t seed, enum rng_stream_enum stream) {
+	rng->state = 0;
+	rng->inc = ((uint64_t)stream << 1) | 1;
+	RNG_Next(rng);
+	rng->state += seed;
+	RNG_Next(rng);
+}
+
+uint32_t RNG_Next(struct RNG *rng) {
+	uint64_t old = rng->state;
+	rng->state = old * 6364136223846793005ULL + rng->inc;
+	uint32_t xorshifted = ((old >> 18) ^ old) >> 27;
+	uint32_t rot = old >> 59;
+	return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+int RNG_Range(struct RNG *rng, int n) {
+	if (n <= 0) return 0;
+	return ((uint64_t)RNG_Next(rng) * (uint32_t)n) >> 32;
+}
+
+float RNG_Float(struct RNG *rng) {
+	return (RNG_Next(rng) >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,48 @@
+/*! \file random.h
+ *  \brief Seedable random number generator headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+/*! \brief Independent random number streams. Generators seeded with the same seed,
+ * but different streams, give uncorrelated sequences. */
+enum rng_stream_enum {
+	RNG_STREAM_OBSTACLES,
+	RNG_STREAM_MENU
+};
+
+/*! \brief State of PCG32 random number generator. */
+struct RNG {
+		uint64_t state; /*!< Internal state. */
+		uint64_t inc; /*!< Stream selector, always odd. */
+};
+
+/*! \brief Seeds generator with given seed, selecting one of the independent streams. */
+void RNG_Seed(struct RNG *rng, uint64_t seed, enum rng_stream_enum stream);
+/*! \brief Returns next uniformly distributed 32-bit number. */
+uint32_t RNG_Next(struct RNG *rng);
+/*! \brief Returns uniformly distributed number in range [0, n). */
+int RNG_Range(struct RNG *rng, int n);
+/*! \brief Returns uniformly distributed number in range [0, 1). */
+float RNG_Float(struct RNG *rng);
+
+#endif
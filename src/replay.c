@@ -0,0 +1,251 @@
+/*! \file replay.c
+ *  \brief Input recording and replay code.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "gamestates/level.h"
+#include "replay.h"
+
+/*! \brief Magic bytes at the beginning of replay file. */
+#define REPLAY_MAGIC "SDRP"
+/*! \brief Version of replay file format. */
+#define REPLAY_VERSION 2
+/*! \brief Byte terminating list of input runs. Never a valid combination of input bits. */
+#define REPLAY_END 0xFF
+
+/*! \brief Calculates checksum of level state, used to verify that playback didn't diverge. */
+unsigned int ReplayChecksum(struct Game *game) {
+	unsigned int hash = 2166136261u;
+	void Hash(void* data, size_t size) {
+		unsigned char *bytes = data;
+		size_t i;
+		for (i=0; i<size; i++) {
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+	}
+	Hash(&game->level.hp, sizeof(float));
+	Hash(&game->level.speed, sizeof(float));
+	Hash(&game->level.speed_modifier, sizeof(float));
+	Hash(&game->level.st_pos, sizeof(float));
+	Hash(&game->level.derpy_x, sizeof(float));
+	Hash(&game->level.derpy_y, sizeof(float));
+	Hash(&game->level.derpy_angle, sizeof(float));
+	Hash(&game->level.sheet_pos, sizeof(int));
+	struct Obstacle *tmp = game->level.dodger.obstacles;
+	while (tmp) {
+		Hash(&tmp->x, sizeof(float));
+		Hash(&tmp->y, sizeof(float));
+		Hash(&tmp->points, sizeof(int));
+		Hash(&tmp->hit, sizeof(bool));
+		tmp = tmp->next;
+	}
+	return hash;
+}
+
+/*! \brief Writes one input run into replay file. */
+void WriteRun(struct Replay *replay) {
+	unsigned int run = replay->run;
+	al_fputc(replay->file, replay->keys);
+	while (run >= 0x80) {
+		al_fputc(replay->file, (run & 0x7F) | 0x80);
+		run >>= 7;
+	}
+	al_fputc(replay->file, run);
+	al_fflush(replay->file);
+}
+
+/*! \brief Reads next input run from replay file. Returns false if there are no more runs. */
+bool ReadRun(struct Replay *replay) {
+	int c = al_fgetc(replay->file);
+	if (c == REPLAY_END) {
+		replay->total = al_fread32le(replay->file);
+		replay->checksum = al_fread32le(replay->file);
+		return false;
+	}
+	if (c == EOF) return false;
+	replay->keys = c;
+	replay->run = 0;
+	int shift = 0;
+	do {
+		c = al_fgetc(replay->file);
+		if (c == EOF) return false;
+		replay->run |= (c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+	return true;
+}
+
+bool Replay_Record(struct Game *game, char* filename) {
+	ALLEGRO_FILE *file = al_fopen(filename, "wb");
+	if (!file) {
+		fprintf(stderr, "failed to open replay file %s for writing!\n", filename);
+		return false;
+	}
+	struct Replay *replay = calloc(1, sizeof(struct Replay));
+	replay->file = file;
+	replay->playback = false;
+	game->replay = replay;
+	return true;
+}
+
+bool Replay_Play(struct Game *game, char* filename) {
+	ALLEGRO_FILE *file = al_fopen(filename, "rb");
+	if (!file) {
+		fprintf(stderr, "failed to open replay file %s!\n", filename);
+		return false;
+	}
+	char magic[4];
+	if ((al_fread(file, magic, 4) != 4) || (strncmp(magic, REPLAY_MAGIC, 4)) || (al_fgetc(file) != REPLAY_VERSION)) {
+		fprintf(stderr, "%s is not a valid replay file!\n", filename);
+		al_fclose(file);
+		return false;
+	}
+	struct Replay *replay = calloc(1, sizeof(struct Replay));
+	replay->file = file;
+	replay->playback = true;
+	replay->level = al_fgetc(file);
+	replay->width = al_fread16le(file);
+	replay->height = al_fread16le(file);
+	replay->seed = al_fread32le(file);
+	game->replay = replay;
+	return true;
+}
+
+void Replay_Start(struct Game *game) {
+	struct Replay *replay = game->replay;
+	if ((!replay) || (replay->started)) return;
+	if (replay->playback) {
+		if (replay->level != game->level.current_level) return;
+		if ((replay->width != game->viewportWidth) || (replay->height != game->viewportHeight)) {
+			fprintf(stderr, "Replay: recorded with viewport %dx%d, playing in %dx%d - playback may diverge!\n", replay->width, replay->height, game->viewportWidth, game->viewportHeight);
+		}
+		game->level.seed = replay->seed;
+		replay->exhausted = !ReadRun(replay);
+		PrintConsole(game, "Replay: playing back level %d", replay->level);
+	} else {
+		replay->level = game->level.current_level;
+		replay->width = game->viewportWidth;
+		replay->height = game->viewportHeight;
+		replay->seed = game->level.seed;
+		al_fwrite(replay->file, REPLAY_MAGIC, 4);
+		al_fputc(replay->file, REPLAY_VERSION);
+		al_fputc(replay->file, replay->level);
+		al_fwrite16le(replay->file, replay->width);
+		al_fwrite16le(replay->file, replay->height);
+		al_fwrite32le(replay->file, replay->seed);
+		al_fflush(replay->file);
+		PrintConsole(game, "Replay: recording level %d", replay->level);
+	}
+	replay->started = true;
+}
+
+unsigned char Replay_Input(struct Game *game, unsigned char keys) {
+	struct Replay *replay = game->replay;
+	if ((!replay) || (!replay->started) || (replay->finished)) return keys;
+	replay->ticks++;
+	if (replay->playback) {
+		if (replay->exhausted) return 0;
+		keys = replay->keys;
+		/* read ahead, so the end of input is known right after its last tick */
+		if ((!--replay->run) && (!ReadRun(replay))) {
+			replay->exhausted = true;
+			PrintConsole(game, "Replay: end of input after %d ticks", replay->ticks);
+		}
+		return keys;
+	}
+	if ((replay->run) && (keys != replay->keys)) {
+		WriteRun(replay);
+		replay->run = 0;
+	}
+	replay->keys = keys;
+	replay->run++;
+	return keys;
+}
+
+void Replay_Stop(struct Game *game) {
+	struct Replay *replay = game->replay;
+	if ((!replay) || (!replay->started) || (replay->finished)) return;
+	replay->finished = true;
+	unsigned int checksum = ReplayChecksum(game);
+	if (replay->playback) {
+		while ((!replay->exhausted) && (ReadRun(replay))) {}
+		if (!replay->total) {
+			PrintConsole(game, "Replay: truncated replay finished after %d ticks", replay->ticks);
+		} else if ((replay->total != replay->ticks) || (replay->checksum != checksum)) {
+			replay->verified = false;
+			fprintf(stderr, "Replay: DESYNC! Recorded %u ticks (checksum %08x), played back %u ticks (checksum %08x)\n", replay->total, replay->checksum, replay->ticks, checksum);
+		} else {
+			replay->verified = true;
+			PrintConsole(game, "Replay: verified %u ticks (checksum %08x)", replay->ticks, checksum);
+		}
+	} else {
+		if (replay->run) WriteRun(replay);
+		al_fputc(replay->file, REPLAY_END);
+		al_fwrite32le(replay->file, replay->ticks);
+		al_fwrite32le(replay->file, checksum);
+		al_fflush(replay->file);
+		PrintConsole(game, "Replay: recorded %u ticks (checksum %08x)", replay->ticks, checksum);
+	}
+}
+
+void Replay_Close(struct Game *game) {
+	if (!game->replay) return;
+	al_fclose(game->replay->file);
+	free(game->replay);
+	game->replay = NULL;
+}
+
+bool Replay_Playing(struct Game *game) {
+	return (game->replay) && (game->replay->playback);
+}
+
+bool Replay_Ended(struct Game *game) {
+	return (Replay_Playing(game)) && (game->replay->started) && (!game->replay->finished) && (game->replay->exhausted) && (game->replay->total);
+}
+
+int Replay_RunHeadless(struct Game *game) {
+	struct Replay *replay = game->replay;
+	if (!Replay_Playing(game)) {
+		fprintf(stderr, "display-less mode needs a replay to play back!\n");
+		return -1;
+	}
+	game->viewportWidth = replay->width;
+	game->viewportHeight = replay->height;
+	game->level.input.current_level = replay->level;
+
+	double start = al_get_time();
+	Level_Preload(game, NULL);
+	double loaded = al_get_time();
+	Level_Load(game);
+	unsigned int ticks = 0, exhausted = 0;
+	while (!game->level.unloading) {
+		Level_Logic(game);
+		ticks++;
+		if ((replay->exhausted) && (!exhausted)) exhausted = ticks;
+		if ((!game->level.unloading) && (exhausted) && (ticks > exhausted + 60*LOGIC_FPS)) {
+			fprintf(stderr, "Replay: level did not finish a minute after the end of input, giving up.\n");
+			Level_Unload(game);
+		}
+	}
+	double end = al_get_time();
+
+	printf("Replay: level %d, %u ticks in %.3f s (%.0f ticks/s), preload %.3f s\n", replay->level, ticks, end-loaded, ticks/(end-loaded), loaded-start);
+	return replay->verified ? 0 : 1;
+}
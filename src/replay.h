@@ -0,0 +1,70 @@
+/*! \file replay.h
+ *  \brief Input recording and replay headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "main.h"
+
+/*! \brief Replay of one level run - its seed and player input sampled on every logic tick.
+ *
+ * File starts with a header (magic, version, level number, viewport size and seed),
+ * followed by input runs (input bits and varint-encoded number of ticks it lasted),
+ * terminated with REPLAY_END byte and trailer with number of ticks and checksum of
+ * the level state at the end of the run.
+ */
+struct Replay {
+		ALLEGRO_FILE *file; /*!< Replay file. */
+		bool playback; /*!< True if replay is being played back, false if recorded. */
+		bool started; /*!< True after level run has been started. */
+		bool finished; /*!< True after level run has been finished. */
+		bool exhausted; /*!< True if there's no more input to play back. */
+		int level; /*!< Number of recorded level. */
+		int width; /*!< Viewport width used during recording. */
+		int height; /*!< Viewport height used during recording. */
+		unsigned int seed; /*!< Seed of random number generator. */
+		unsigned char keys; /*!< Input bits of current run. */
+		unsigned int run; /*!< Number of ticks recorded into (or left to play back from) current run. */
+		unsigned int ticks; /*!< Number of ticks recorded or played back so far. */
+		unsigned int total; /*!< Number of ticks stored in trailer, 0 if replay has been truncated. */
+		unsigned int checksum; /*!< Checksum stored in trailer. */
+		bool verified; /*!< True if played back run matched the trailer. */
+};
+
+/*! \brief Opens replay file for recording next level run. */
+bool Replay_Record(struct Game *game, char* filename);
+/*! \brief Opens replay file for playback and reads its header. */
+bool Replay_Play(struct Game *game, char* filename);
+/*! \brief Starts level run: writes header or checks if viewport matches, and chooses the seed. */
+void Replay_Start(struct Game *game);
+/*! \brief Records or replaces input of current logic tick. */
+unsigned char Replay_Input(struct Game *game, unsigned char keys);
+/*! \brief Finishes level run: writes or verifies trailer. */
+void Replay_Stop(struct Game *game);
+/*! \brief Closes replay file. */
+void Replay_Close(struct Game *game);
+/*! \brief Checks if there's a replay being played back. */
+bool Replay_Playing(struct Game *game);
+/*! \brief Checks if played back level run has been ended by the player (and not by the game) at this point. */
+bool Replay_Ended(struct Game *game);
+/*! \brief Plays back replay as fast as possible without display and audio. */
+int Replay_RunHeadless(struct Game *game);
+
+#endif
@@ -0,0 +1,82 @@
+/*! \file sound.c
+ *  \brief Shared pool of sound samples and their playing instances.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "assets.h"
+#include "sound.h"
+
+/*! \brief Destroys sound effect together with its instances. */
+void SoundDestroy(void* data) {
+	struct Sound *sound = data;
+	int i;
+	for (i=0; i<SOUND_POOL_SIZE; i++) {
+		al_destroy_sample_instance(sound->pool[i]);
+	}
+	al_destroy_sample(sound->sample);
+	free(sound);
+}
+
+struct Sound* Sound_Load(struct Game *game, char* filename) {
+	struct Sound *sound = Assets_Get(game, ASSET_SOUND, filename);
+	if (sound) return sound;
+	char* path = GetDataFilePath(filename);
+	ALLEGRO_SAMPLE *sample = al_load_sample(path);
+	free(path);
+	if (!sample) {
+		fprintf(stderr, "Audio clip %s not loaded!\n", filename);
+		exit(-1);
+	}
+	sound = calloc(1, sizeof(struct Sound));
+	sound->sample = sample;
+	Track_Retag(sample, "assets");
+	int i;
+	for (i=0; i<SOUND_POOL_SIZE; i++) {
+		sound->pool[i] = al_create_sample_instance(sample);
+		al_attach_sample_instance_to_mixer(sound->pool[i], game->audio.fx);
+		al_set_sample_instance_playmode(sound->pool[i], ALLEGRO_PLAYMODE_ONCE);
+	}
+	Assets_Add(game, ASSET_SOUND, filename, sound, al_get_sample_length(sample) * al_get_channel_count(al_get_sample_channels(sample)) * al_get_audio_depth_size(al_get_sample_depth(sample)), &SoundDestroy);
+	return sound;
+}
+
+void Sound_Play(struct Sound *sound) {
+	int i;
+	for (i=0; i<SOUND_POOL_SIZE; i++) {
+		if (!al_get_sample_instance_playing(sound->pool[i])) {
+			al_play_sample_instance(sound->pool[i]);
+			return;
+		}
+	}
+	/* all instances are busy, so restart them in turn */
+	al_stop_sample_instance(sound->pool[sound->next]);
+	al_play_sample_instance(sound->pool[sound->next]);
+	sound->next = (sound->next + 1) % SOUND_POOL_SIZE;
+}
+
+void Sound_Stop(struct Sound *sound) {
+	int i;
+	for (i=0; i<SOUND_POOL_SIZE; i++) {
+		al_stop_sample_instance(sound->pool[i]);
+	}
+}
+
+void Sound_Release(struct Game *game, struct Sound *sound) {
+	Assets_Release(game, sound);
+}
@@ -0,0 +1,45 @@
+/*! \file sound.h
+ *  \brief Shared pool of sound samples and their playing instances headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef SOUND_H
+#define SOUND_H
+
+#include "main.h"
+
+/*! \brief Number of sample instances kept for every sound effect, so overlapping plays don't cut each other off. */
+#define SOUND_POOL_SIZE 4
+
+/*! \brief Sound effect decoded once and shared by every gamestate that uses it. */
+struct Sound {
+		ALLEGRO_SAMPLE *sample; /*!< Decoded sample. */
+		ALLEGRO_SAMPLE_INSTANCE *pool[SOUND_POOL_SIZE]; /*!< Instances attached to effects mixer. */
+		int next; /*!< Index of instance to be reused when all of them are playing. */
+};
+
+/*! \brief Returns sound effect from given data file, decoding it only if asset manager doesn't have it yet. */
+struct Sound* Sound_Load(struct Game *game, char* filename);
+/*! \brief Plays sound effect on first idle instance from the pool. */
+void Sound_Play(struct Sound *sound);
+/*! \brief Stops every instance of sound effect. */
+void Sound_Stop(struct Sound *sound);
+/*! \brief Drops reference to sound effect, leaving it to asset manager. */
+void Sound_Release(struct Game *game, struct Sound *sound);
+
+#endif
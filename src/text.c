@@ -0,0 +1,157 @@
+/*! \file text.c
+ *  \brief Cached text rendering code.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "text.h"
+
+/*! \brief Maximum number of texts held by the atlas. */
+#define TEXT_CACHE_SIZE 128
+/*! \brief Empty space around every cell, so filtering doesn't bleed neighbouring texts in. */
+#define TEXT_PADDING 1
+
+/*! \brief Hashes text, the same way replay checksum is calculated. */
+unsigned int TextHash(char const *text) {
+	unsigned int hash = 2166136261u;
+	while (*text) {
+		hash ^= (unsigned char)*text++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+void Text_Init(struct Game *game) {
+	game->text.atlas = al_create_bitmap(game->viewportWidth, game->viewportHeight);
+	game->text.entries = calloc(TEXT_CACHE_SIZE, sizeof(struct TextEntry));
+	game->text.count = 0;
+	Text_Flush(game);
+}
+
+void Text_Flush(struct Game *game) {
+	int i;
+	for (i=0; i<game->text.count; i++) {
+		free(game->text.entries[i].text);
+	}
+	game->text.count = 0;
+	game->text.shelf_x = 0;
+	game->text.shelf_y = 0;
+	game->text.shelf_height = 0;
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
+	al_set_target_bitmap(game->text.atlas);
+	al_clear_to_color(al_map_rgba(0,0,0,0));
+	al_set_target_bitmap(target);
+}
+
+void Text_Destroy(struct Game *game) {
+	Text_Flush(game);
+	free(game->text.entries);
+	al_destroy_bitmap(game->text.atlas);
+}
+
+/*! \brief Reserves space for w×h cell on current shelf of the atlas, or on a new one. Returns false if atlas is full. */
+bool TextAllocate(struct Game *game, int w, int h, int *x, int *y) {
+	int width = al_get_bitmap_width(game->text.atlas), height = al_get_bitmap_height(game->text.atlas);
+	if (game->text.shelf_x + w > width) {
+		game->text.shelf_x = 0;
+		game->text.shelf_y += game->text.shelf_height;
+		game->text.shelf_height = 0;
+	}
+	if ((w > width) || (game->text.shelf_y + h > height)) return false;
+	*x = game->text.shelf_x;
+	*y = game->text.shelf_y;
+	game->text.shelf_x += w;
+	if (h > game->text.shelf_height) game->text.shelf_height = h;
+	return true;
+}
+
+/*! \brief Returns text already rendered into the atlas, or NULL. */
+struct TextEntry* TextFind(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, bool shadow, char const *text, unsigned int hash) {
+	int i;
+	for (i=0; i<game->text.count; i++) {
+		struct TextEntry *entry = &game->text.entries[i];
+		if ((entry->hash == hash) && (entry->font == font) && (entry->shadow == shadow) && (!memcmp(&entry->color, &color, sizeof(ALLEGRO_COLOR))) && (!strcmp(entry->text, text))) return entry;
+	}
+	return NULL;
+}
+
+/*! \brief Renders text into the atlas, flushing it if it's full. Returns NULL if text doesn't fit even in empty atlas. */
+struct TextEntry* TextRender(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, bool shadow, char const *text, unsigned int hash) {
+	int bbx, bby, bbw, bbh, x, y;
+	al_get_text_dimensions(font, text, &bbx, &bby, &bbw, &bbh);
+	int w = bbw + 2*TEXT_PADDING + shadow, h = bbh + 2*TEXT_PADDING + shadow;
+	if ((game->text.count == TEXT_CACHE_SIZE) || (!TextAllocate(game, w, h, &x, &y))) {
+		/* texts which are still in use come back on their next draw */
+		Text_Flush(game);
+		if (!TextAllocate(game, w, h, &x, &y)) return NULL;
+	}
+
+	struct TextEntry *entry = &game->text.entries[game->text.count++];
+	entry->text = strdup(text);
+	/* cache outlives the gamestate which drew the text */
+	Track_Retag(entry->text, "text");
+	entry->hash = hash;
+	entry->font = font;
+	entry->color = color;
+	entry->shadow = shadow;
+	entry->x = x;
+	entry->y = y;
+	entry->w = w;
+	entry->h = h;
+	entry->dx = bbx - TEXT_PADDING;
+	entry->dy = bby - TEXT_PADDING;
+	entry->width = al_get_text_width(font, text);
+
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP | ALLEGRO_STATE_BLENDER);
+	al_set_target_bitmap(game->text.atlas);
+	al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
+	if (shadow) al_draw_text_with_shadow(font, color, x - entry->dx, y - entry->dy, ALLEGRO_ALIGN_LEFT, text);
+	else al_draw_text(font, color, x - entry->dx, y - entry->dy, ALLEGRO_ALIGN_LEFT, text);
+	al_restore_state(&state);
+	return entry;
+}
+
+/*! \brief Draws text from the atlas, falling back to drawing it directly. */
+void TextDraw(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int flags, char const *text, bool shadow) {
+	unsigned int hash = TextHash(text);
+	struct TextEntry *entry = TextFind(game, font, color, shadow, text, hash);
+	if (!entry) {
+		/* held drawing has to be flushed before the atlas changes */
+		bool held = al_is_bitmap_drawing_held();
+		if (held) al_hold_bitmap_drawing(false);
+		entry = TextRender(game, font, color, shadow, text, hash);
+		if (held) al_hold_bitmap_drawing(true);
+	}
+	if (!entry) {
+		if (shadow) al_draw_text_with_shadow(font, color, x, y, flags, text);
+		else al_draw_text(font, color, x, y, flags, text);
+		return;
+	}
+	if (flags & ALLEGRO_ALIGN_CENTRE) x -= entry->width/2.0;
+	else if (flags & ALLEGRO_ALIGN_RIGHT) x -= entry->width;
+	al_draw_bitmap_region(game->text.atlas, entry->x, entry->y, entry->w, entry->h, x + entry->dx, y + entry->dy, 0);
+}
+
+void Text_Draw(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int flags, char const *text) {
+	TextDraw(game, font, color, x, y, flags, text, false);
+}
+
+void Text_DrawWithShadow(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int flags, char const *text) {
+	TextDraw(game, font, color, x, y, flags, text, true);
+}
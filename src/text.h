@@ -0,0 +1,57 @@
+/*! \file text.h
+ *  \brief Cached text rendering headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef TEXT_H
+#define TEXT_H
+
+#include "main.h"
+
+/*! \brief Text rendered into the atlas, identified by its font, color, shadow and content. */
+struct TextEntry {
+		char* text; /*!< Rendered text. */
+		unsigned int hash; /*!< Hash of the text, compared before the text itself. */
+		ALLEGRO_FONT *font; /*!< Font of the text. */
+		ALLEGRO_COLOR color; /*!< Color of the text. */
+		bool shadow; /*!< True if text has been rendered with shadow. */
+		int x; /*!< Horizontal position of the cell in the atlas. */
+		int y; /*!< Vertical position of the cell in the atlas. */
+		int w; /*!< Width of the cell. */
+		int h; /*!< Height of the cell. */
+		int dx; /*!< Horizontal offset of the cell from left-aligned text position. */
+		int dy; /*!< Vertical offset of the cell from text position. */
+		int width; /*!< Width of the text, used for alignment. */
+};
+
+/*! \brief Creates empty text atlas. */
+void Text_Init(struct Game *game);
+/*! \brief Draws text like al_draw_text, rendering it into the atlas only if it isn't there yet.
+ *
+ * Consecutive calls are batched into one pass when bitmap drawing is held.
+ * Font has to stay loaded as long as the cache, which holds for fonts loaded with Font_Load.
+ */
+void Text_Draw(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int flags, char const *text);
+/*! \brief Draws text like al_draw_text_with_shadow, rendering it into the atlas only if it isn't there yet. */
+void Text_DrawWithShadow(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int flags, char const *text);
+/*! \brief Forgets every rendered text. */
+void Text_Flush(struct Game *game);
+/*! \brief Destroys text atlas. */
+void Text_Destroy(struct Game *game);
+
+#endif
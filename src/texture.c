@@ -0,0 +1,266 @@
+/*! \file texture.c
+ *  \brief Baked texture format.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include "texture.h"
+
+/*! \brief Minimal length of LZ4 match. */
+#define LZ4_MINMATCH 4
+/*! \brief Last bytes of LZ4 block are always literals, and no match may start this close to its end. */
+#define LZ4_MFLIMIT 12
+/*! \brief Number of bits of compressor hash table index. */
+#define LZ4_HASHLOG 16
+
+/*! \brief Manifest of baked textures, NULL if there are none. */
+ALLEGRO_CONFIG *texture_manifest = NULL;
+
+/*! \brief Returns upper bound of LZ4 compressed size of given number of bytes. */
+size_t LZ4Bound(size_t size) {
+	return size + size/255 + 16;
+}
+
+unsigned int Read32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+/*! \brief Writes length continuation bytes of LZ4 sequence. */
+unsigned char* WriteLength(unsigned char *op, size_t length) {
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = length;
+	return op;
+}
+
+/*! \brief Compresses data into LZ4 block with greedy matching. Returns compressed size. */
+size_t LZ4Compress(const unsigned char *src, size_t size, unsigned char *dst) {
+	size_t *table = calloc(1 << LZ4_HASHLOG, sizeof(size_t));
+	size_t ip = 0, anchor = 0;
+	unsigned char *op = dst;
+	void Emit(size_t literals, size_t offset, size_t match) {
+		unsigned char *token = op++;
+		*token = (literals < 15 ? literals : 15) << 4;
+		if (literals >= 15) op = WriteLength(op, literals - 15);
+		memcpy(op, src + anchor, literals);
+		op += literals;
+		if (!match) return;
+		*op++ = offset & 0xFF;
+		*op++ = offset >> 8;
+		match -= LZ4_MINMATCH;
+		*token |= match < 15 ? match : 15;
+		if (match >= 15) op = WriteLength(op, match - 15);
+	}
+	while (ip + LZ4_MFLIMIT < size) {
+		unsigned int sequence = Read32(src + ip);
+		unsigned int hash = (sequence * 2654435761u) >> (32 - LZ4_HASHLOG);
+		size_t ref = table[hash];
+		table[hash] = ip + 1;
+		if ((!ref--) || (ip - ref > 0xFFFF) || (Read32(src + ref) != sequence)) {
+			ip++;
+			continue;
+		}
+		size_t match = LZ4_MINMATCH;
+		while ((ip + match + 5 < size) && (src[ref + match] == src[ip + match])) match++;
+		Emit(ip - anchor, ip - ref, match);
+		ip += match;
+		anchor = ip;
+	}
+	Emit(size - anchor, 0, 0);
+	free(table);
+	return op - dst;
+}
+
+/*! \brief Decompresses LZ4 block, which must decompress into exactly given number of bytes. */
+bool LZ4Decompress(const unsigned char *src, size_t size, unsigned char *dst, size_t dstsize) {
+	const unsigned char *ip = src, *end = src + size;
+	size_t op = 0;
+	bool ReadLength(size_t *length) {
+		unsigned char byte;
+		do {
+			if (ip >= end) return false;
+			byte = *ip++;
+			*length += byte;
+		} while (byte == 255);
+		return true;
+	}
+	while (ip < end) {
+		unsigned char token = *ip++;
+		size_t length = token >> 4;
+		if ((length == 15) && (!ReadLength(&length))) return false;
+		if ((length > (size_t)(end - ip)) || (length > dstsize - op)) return false;
+		memcpy(dst + op, ip, length);
+		ip += length;
+		op += length;
+		/* last sequence has literals only */
+		if (ip == end) break;
+		if (end - ip < 2) return false;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if ((!offset) || (offset > op)) return false;
+		length = token & 15;
+		if ((length == 15) && (!ReadLength(&length))) return false;
+		length += LZ4_MINMATCH;
+		if (length > dstsize - op) return false;
+		/* match may overlap with bytes it produces, so it's copied byte by byte */
+		while (length--) {
+			dst[op] = dst[op - offset];
+			op++;
+		}
+	}
+	return op == dstsize;
+}
+
+/*! \brief Loads baked texture from opened file. */
+ALLEGRO_BITMAP* Texture_Load_f(ALLEGRO_FILE *file) {
+	unsigned char header[TEXTURE_HEADER_SIZE];
+	if ((al_fread(file, header, TEXTURE_HEADER_SIZE) != TEXTURE_HEADER_SIZE) || (memcmp(header, TEXTURE_MAGIC, 4)) || (Read32(header + 4) != TEXTURE_VERSION)) return NULL;
+	int width = Read32(header + 8), height = Read32(header + 12);
+	unsigned int flags = Read32(header + 16);
+	size_t size = Read32(header + 20), pixels = (size_t)width * height * 4;
+	if ((width <= 0) || (height <= 0) || ((!(flags & TEXTURE_LZ4)) && (size != pixels))) return NULL;
+
+	unsigned char *data = malloc(size);
+	if ((!data) || (al_fread(file, data, size) != size)) {
+		free(data);
+		return NULL;
+	}
+	ALLEGRO_BITMAP *bitmap = al_create_bitmap(width, height);
+	if (!bitmap) {
+		free(data);
+		return NULL;
+	}
+	ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	if (!region) {
+		al_destroy_bitmap(bitmap);
+		free(data);
+		return NULL;
+	}
+	bool ok = true;
+	unsigned char *raw = data;
+	if (flags & TEXTURE_LZ4) {
+		/* tightly packed region can be decompressed into directly */
+		if (region->pitch == width * 4) {
+			ok = LZ4Decompress(data, size, region->data, pixels);
+			raw = NULL;
+		} else {
+			raw = malloc(pixels);
+			ok = (raw) && (LZ4Decompress(data, size, raw, pixels));
+		}
+	}
+	if ((ok) && (raw)) {
+		int y;
+		for (y=0; y<height; y++) {
+			memcpy((unsigned char*)region->data + y * region->pitch, raw + (size_t)y * width * 4, width * 4);
+		}
+	}
+	al_unlock_bitmap(bitmap);
+	if (raw != data) free(raw);
+	free(data);
+	if (!ok) {
+		al_destroy_bitmap(bitmap);
+		return NULL;
+	}
+	return bitmap;
+}
+
+ALLEGRO_BITMAP* Texture_Load(const char *filename) {
+	ALLEGRO_FILE *file = al_fopen(filename, "rb");
+	if (!file) return NULL;
+	ALLEGRO_BITMAP *bitmap = Texture_Load_f(file);
+	al_fclose(file);
+	return bitmap;
+}
+
+/*! \brief Saves bitmap as baked texture into opened file, compressing it if it pays off. */
+bool Texture_Save_f(ALLEGRO_FILE *file, ALLEGRO_BITMAP *bitmap) {
+	int width = al_get_bitmap_width(bitmap), height = al_get_bitmap_height(bitmap), y;
+	size_t pixels = (size_t)width * height * 4;
+	unsigned char *raw = malloc(pixels), *packed = malloc(LZ4Bound(pixels));
+	ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+	if ((!raw) || (!packed) || (!region)) {
+		if (region) al_unlock_bitmap(bitmap);
+		free(raw);
+		free(packed);
+		return false;
+	}
+	/* bitmaps are kept with premultiplied alpha already, so pixels are stored as they are */
+	for (y=0; y<height; y++) {
+		memcpy(raw + (size_t)y * width * 4, (unsigned char*)region->data + y * region->pitch, width * 4);
+	}
+	al_unlock_bitmap(bitmap);
+
+	unsigned int flags = 0;
+	size_t size = LZ4Compress(raw, pixels, packed);
+	unsigned char *data = packed;
+	if (size < pixels) {
+		flags |= TEXTURE_LZ4;
+	} else {
+		data = raw;
+		size = pixels;
+	}
+	al_fwrite(file, TEXTURE_MAGIC, 4);
+	al_fwrite32le(file, TEXTURE_VERSION);
+	al_fwrite32le(file, width);
+	al_fwrite32le(file, height);
+	al_fwrite32le(file, flags);
+	al_fwrite32le(file, size);
+	bool ok = al_fwrite(file, data, size) == size;
+	free(raw);
+	free(packed);
+	return ok;
+}
+
+bool Texture_Save(const char *filename, ALLEGRO_BITMAP *bitmap) {
+	ALLEGRO_FILE *file = al_fopen(filename, "wb");
+	if (!file) return false;
+	bool ok = (Texture_Save_f(file, bitmap)) && (al_fflush(file)) && (!al_ferror(file));
+	al_fclose(file);
+	return ok;
+}
+
+void Texture_Init(void) {
+	al_register_bitmap_loader(TEXTURE_EXTENSION, Texture_Load);
+	al_register_bitmap_loader_f(TEXTURE_EXTENSION, Texture_Load_f);
+	al_register_bitmap_saver(TEXTURE_EXTENSION, Texture_Save);
+	al_register_bitmap_saver_f(TEXTURE_EXTENSION, Texture_Save_f);
+
+	if (texture_manifest) al_destroy_config(texture_manifest);
+	texture_manifest = NULL;
+	char* path = FindDataFilePath(TEXTURE_MANIFEST);
+	if (!path) return;
+	texture_manifest = al_load_config_file(path);
+	free(path);
+}
+
+char* Texture_FindBaked(char* filename, int width, int height) {
+	char key[255];
+	if (!texture_manifest) return NULL;
+	snprintf(key, 255, "%s@%dx%d", filename, width, height);
+	const char* name = al_get_config_value(texture_manifest, "textures", key);
+	if (!name) return NULL;
+	return FindDataFilePath((char*)name);
+}
+
+char* Texture_GetBakedFilename(char* filename, int width, int height) {
+	char* name = malloc(strlen(filename) + strlen(TEXTURE_EXTENSION) + 32);
+	sprintf(name, "baked/%s@%dx%d%s", filename, width, height, TEXTURE_EXTENSION);
+	return name;
+}
@@ -0,0 +1,54 @@
+/*! \file texture.h
+ *  \brief Baked texture format headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include "main.h"
+
+/*! \brief Magic bytes at the beginning of baked texture.
+ *
+ * Baked texture is a bitmap already scaled to the size it's used at, stored as raw premultiplied
+ * RGBA rows, optionally compressed with LZ4 block format. It starts with a header (all numbers
+ * are 32-bit little endian): magic, version, width, height, flags and size of stored pixel data.
+ */
+#define TEXTURE_MAGIC "SDTX"
+/*! \brief Version of baked texture format. */
+#define TEXTURE_VERSION 1
+/*! \brief Size of baked texture header. */
+#define TEXTURE_HEADER_SIZE 24
+/*! \brief File extension of baked textures. */
+#define TEXTURE_EXTENSION ".sdtex"
+/*! \brief Manifest listing baked textures, relative to data directory. */
+#define TEXTURE_MANIFEST "baked/manifest.ini"
+
+/*! \brief Flags of baked texture. */
+enum texture_flags_enum {
+	TEXTURE_LZ4 = 1 /*!< Pixel data is LZ4 compressed. */
+};
+
+/*! \brief Registers baked texture loader and saver, so al_load_bitmap and al_save_bitmap handle .sdtex files, and reads manifest of baked textures. */
+void Texture_Init(void);
+/*! \brief Returns path of texture baked from given data file at given size, or NULL if manifest doesn't list one. Must be freed. */
+char* Texture_FindBaked(char* filename, int width, int height);
+/*! \brief Returns path of baked texture made from given data file at given size. Must be freed. */
+char* Texture_GetBakedFilename(char* filename, int width, int height);
+
+#endif
@@ -18,13 +18,17 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
  */
+#include <stdio.h>
 #include <allegro5/allegro.h>
+#include <allegro5/allegro_primitives.h>
+#include <allegro5/allegro_font.h>
 #include "main.h"
 #include "timeline.h"
 
-unsigned int lastid;
-struct Game* game = NULL;
-struct TM_Action *queue, *background;
+/* every thread has its own timeline, so simulations can run in parallel */
+__thread unsigned int lastid;
+__thread struct Game* game = NULL;
+__thread struct TM_Action *queue, *background;
 
 void TM_Init(struct Game* g) {
 	PrintConsole(g, "Timeline Manager: init");
@@ -34,6 +38,30 @@ void TM_Init(struct Game* g) {
 	background = NULL;
 }
 
+/*! \brief Runs action callback, accounting time spent in RUNNING and DRAW states. */
+bool RunAction(struct TM_Action *action, enum TM_ActionState state) {
+	if ((state != TM_ACTIONSTATE_RUNNING) && (state != TM_ACTIONSTATE_DRAW)) return (*action->function)(game, action, state);
+	double start = al_get_time();
+	bool ret = (*action->function)(game, action, state);
+	double time = al_get_time() - start;
+	if (state == TM_ACTIONSTATE_RUNNING) {
+		action->running_time += time;
+		if (time > action->running_peak) action->running_peak = time;
+	} else {
+		action->draw_time += time;
+		if (time > action->draw_peak) action->draw_peak = time;
+	}
+	return ret;
+}
+
+/*! \brief Converts delay in miliseconds to number of logic ticks. */
+int DelayToTicks(int delay) {
+	if (delay <= 0) return 0;
+	int ticks = (delay * LOGIC_FPS + 500) / 1000;
+	if (ticks < 1) ticks = 1;
+	return ticks;
+}
+
 void TM_Process(void) {
 	if (!game) return;
 	/* process first element from queue
@@ -45,7 +73,7 @@ void TM_Process(void) {
 				(*queue->function)(game, queue, TM_ACTIONSTATE_START);
 			}
 			queue->active = true;
-			if ((*queue->function)(game, queue, TM_ACTIONSTATE_RUNNING)) {
+			if (RunAction(queue, TM_ACTIONSTATE_RUNNING)) {
 				PrintConsole(game, "Timeline Manager: queue: destroy action (%d - %s)", queue->id, queue->name);
 				queue->active=false;
 				struct TM_Action *tmp = queue;
@@ -56,74 +84,44 @@ void TM_Process(void) {
 			}
 		} else {
 			/* delay handling */
-			if (queue->active) {
+			if (!queue->active) {
+				PrintConsole(game, "Timeline Manager: queue: delay started %d ms (%d - %s)", queue->delay, queue->id, queue->name);
+				queue->active = true;
+			}
+			if (queue->ticks > 0) queue->ticks--;
+			if (queue->ticks <= 0) {
+				PrintConsole(game, "Timeline Manager: queue: delay reached (%d - %s)", queue->id, queue->name);
 				struct TM_Action *tmp = queue;
 				queue = queue->next;
 				free(tmp->name);
 				free(tmp);
-			} else {
-				if (!al_get_timer_started(queue->timer)) {
-					PrintConsole(game, "Timeline Manager: queue: delay started %d ms (%d - %s)", queue->delay, queue->id, queue->name);
-					al_start_timer(queue->timer);
-				}
 			}
 		}
 	}
-	/* process all elements from background marked as active */
-	struct TM_Action *tmp, *tmp2, *pom = background;
-	tmp = NULL;
-	while (pom!=NULL) {
-		if (pom->active) {
-			if (*pom->function) {
-				if ((*pom->function)(game, pom, TM_ACTIONSTATE_RUNNING)) {
-					pom->active=false;
-					PrintConsole(game, "Timeline Manager: background: destroy action (%d - %s)", pom->id, pom->name);
-					(*pom->function)(game, pom, TM_ACTIONSTATE_DESTROY);
-					if (tmp) {
-						tmp->next = pom->next;
-					} else {
-						background = pom->next;
-					}
-				}
-			} else {
-				/* delay handling */
-				if (tmp) {
-					tmp->next = pom->next;
-				} else {
-					background = pom->next;
-				}
+	/* destroyed action could have destroyed the whole timeline */
+	if (!game) return;
+	/* process all elements from background marked as active,
+		 count down delays of the rest */
+	struct TM_Action *tmp, **pom = &background;
+	while (*pom) {
+		tmp = *pom;
+		if (!tmp->active) {
+			if ((tmp->ticks > 0) && (!--tmp->ticks)) {
+				PrintConsole(game, "Timeline Manager: background: delay reached, run action (%d - %s)", tmp->id, tmp->name);
+				tmp->active = true;
+				(*tmp->function)(game, tmp, TM_ACTIONSTATE_START);
 			}
+		} else if (RunAction(tmp, TM_ACTIONSTATE_RUNNING)) {
+			tmp->active=false;
+			PrintConsole(game, "Timeline Manager: background: destroy action (%d - %s)", tmp->id, tmp->name);
+			*pom = tmp->next;
+			(*tmp->function)(game, tmp, TM_ACTIONSTATE_DESTROY);
+			free(tmp->name);
+			free(tmp);
+			if (!game) return;
+			continue;
 		}
-		if ((!tmp) || (tmp->next==pom)) {
-			tmp = pom;
-			pom = pom->next;
-		} else {
-			free(pom->name);
-			free(pom);
-			tmp2 = tmp;
-			if (!tmp) pom=background->next;
-			else pom=tmp->next;
-			tmp = tmp2;
-		}
-	}
-}
-
-void PauseTimers(bool pause) {
-	if (queue) {
-		if (queue->timer) {
-			if (pause) {
-				al_stop_timer(queue->timer);
-			} else if (!queue->active) al_start_timer(queue->timer);
-		}
-	}
-	struct TM_Action* tmp = background;
-	while (tmp) {
-		if (tmp->timer) {
-			if (pause) {
-				al_stop_timer(tmp->timer);
-			} else if (!tmp->active) al_start_timer(tmp->timer);
-		}
-		tmp = tmp->next;
+		pom = &tmp->next;
 	}
 }
 
@@ -131,7 +129,7 @@ void Propagate(enum TM_ActionState action) {
 	if (!game) return;
 	if (queue) {
 		if ((*queue->function) && (queue->active)) {
-			(*queue->function)(game, queue, action);
+			RunAction(queue, action);
 		}
 	}
 	/* process all elements from background marked as active */
@@ -139,7 +137,7 @@ void Propagate(enum TM_ActionState action) {
 	while (pom!=NULL) {
 		if (pom->active) {
 			if (*pom->function) {
-				(*pom->function)(game, pom, action);
+				RunAction(pom, action);
 			}
 		}
 		pom = pom->next;
@@ -152,45 +150,12 @@ void TM_Draw(void) {
 
 void TM_Pause(void) {
 	PrintConsole(game, "Timeline Manager: Pause.");
-	PauseTimers(true);
 	Propagate(TM_ACTIONSTATE_PAUSE);
 }
 
 void TM_Resume(void) {
 	PrintConsole(game, "Timeline Manager: Resume.");
 	Propagate(TM_ACTIONSTATE_RESUME);
-	PauseTimers(false);
-}
-
-void TM_HandleEvent(ALLEGRO_EVENT *ev) {
-	if (ev->type != ALLEGRO_EVENT_TIMER) return;
-	if (!game) return;
-	if (queue) {
-		if (ev->timer.source == queue->timer) {
-			queue->active=true;
-			al_destroy_timer(queue->timer);
-			queue->timer = NULL;
-			if (queue->function) {
-				PrintConsole(game, "Timeline Manager: queue: run action (%d - %s)", queue->id, queue->name);
-				(*queue->function)(game, queue, TM_ACTIONSTATE_START);
-			} else {
-				PrintConsole(game, "Timeline Manager: queue: delay reached (%d - %s)", queue->id, queue->name);
-			}
-			return;
-		}
-	}
-	struct TM_Action *pom = background;
-	while (pom) {
-		if (ev->timer.source == pom->timer) {
-			PrintConsole(game, "Timeline Manager: background: delay reached, run action (%d - %s)", pom->id, pom->name);
-			pom->active=true;
-			al_destroy_timer(pom->timer);
-			pom->timer = NULL;
-			(*pom->function)(game, pom, TM_ACTIONSTATE_START);
-			return;
-		}
-		pom=pom->next;
-	}
 }
 
 struct TM_Action* TM_AddAction(bool (*func)(struct Game*, struct TM_Action*, enum TM_ActionState), struct TM_Arguments* args, char* name) {
@@ -209,10 +174,15 @@ struct TM_Action* TM_AddAction(bool (*func)(struct Game*, struct TM_Action*, enu
 	action->arguments = args;
 	action->name = malloc((strlen(name)+1)*sizeof(char));
 	strcpy(action->name, name);
-	action->timer = NULL;
+	action->ticks = 0;
 	action->active = false;
 	action->delay = 0;
+	action->running_time = 0;
+	action->running_peak = 0;
+	action->draw_time = 0;
+	action->draw_peak = 0;
 	action->id = ++lastid;
+	action->spritesheet = -1;
 	if (action->function) {
 		PrintConsole(game, "Timeline Manager: queue: init action (%d - %s)", action->id, action->name);
 		(*action->function)(game, action, TM_ACTIONSTATE_INIT);
@@ -237,18 +207,20 @@ struct TM_Action* TM_AddBackgroundAction(bool (*func)(struct Game*, struct TM_Ac
 	action->name = malloc((strlen(name)+1)*sizeof(char));
 	strcpy(action->name, name);
 	action->delay = delay;
+	action->ticks = DelayToTicks(delay);
+	action->running_time = 0;
+	action->running_peak = 0;
+	action->draw_time = 0;
+	action->draw_peak = 0;
 	action->id = ++lastid;
-	if (delay) {
+	action->spritesheet = -1;
+	if (action->ticks) {
 		PrintConsole(game, "Timeline Manager: background: init action with delay %d ms (%d - %s)", delay, action->id, action->name);
 		(*action->function)(game, action, TM_ACTIONSTATE_INIT);
 		action->active = false;
-		action->timer = al_create_timer(delay/1000.0);
-		al_register_event_source(game->event_queue, al_get_timer_event_source(action->timer));
-		al_start_timer(action->timer);
 	} else {
 		PrintConsole(game, "Timeline Manager: background: init action (%d - %s)", action->id, action->name);
 		(*action->function)(game, action, TM_ACTIONSTATE_INIT);
-		action->timer = NULL;
 		action->active = true;
 		PrintConsole(game, "Timeline Manager: background: run action (%d - %s)", action->id, action->name);
 		(*action->function)(game, action, TM_ACTIONSTATE_START);
@@ -258,11 +230,25 @@ struct TM_Action* TM_AddBackgroundAction(bool (*func)(struct Game*, struct TM_Ac
 
 /*! \brief Predefined action used by TM_AddQueuedBackgroundAction */
 bool runinbackground(struct Game* game, struct TM_Action* action, enum TM_ActionState state) {
+	if ((state == TM_ACTIONSTATE_DESTROY) && (action->arguments)) {
+		/* timeline is destroyed before the action has been passed to background */
+		free(action->arguments->next->value);
+		free(action->arguments->next->next->value);
+		TM_DestroyArgs(action->arguments);
+		action->arguments = NULL;
+		return false;
+	}
 	if (state != TM_ACTIONSTATE_RUNNING) return false;
 	int* delay = (int*) action->arguments->next->value;
 	char* name = (char*) action->arguments->next->next->value;
-	TM_AddBackgroundAction(action->arguments->value, action->arguments->next->next->next, *delay, name);
+	struct TM_Arguments* args = action->arguments->next->next->next;
+	TM_AddBackgroundAction(action->arguments->value, args, *delay, name);
+	/* passed arguments belong to the background action now */
+	action->arguments->next->next->next = NULL;
+	free(delay);
 	free(name);
+	TM_DestroyArgs(action->arguments);
+	action->arguments = NULL;
 	return true;
 }
 
@@ -286,62 +272,48 @@ void TM_AddDelay(int delay) {
 	struct TM_Action* tmp = TM_AddAction(NULL, NULL, "TM_Delay");
 	PrintConsole(game, "Timeline Manager: queue: adding delay %d ms (%d)", delay, tmp->id);
 	tmp->delay = delay;
-	tmp->timer = al_create_timer(delay/1000.0);
-	al_register_event_source(game->event_queue, al_get_timer_event_source(tmp->timer));
+	tmp->ticks = DelayToTicks(delay);
 }
 
-void TM_Destroy(void) {
-	if (!game) return;
-	PrintConsole(game, "Timeline Manager: destroy");
-	struct TM_Action *tmp, *tmp2, *pom = queue;
-	tmp = NULL;
-	while (pom!=NULL) {
-		if (pom->active) {
-			if (*pom->function) (*pom->function)(game, pom, TM_ACTIONSTATE_DESTROY);
-			else {
-				if (pom->timer) al_destroy_timer(pom->timer);
-			}
-		} else {
-			TM_DestroyArgs(pom->arguments);
-			pom->arguments = NULL;
-		}
-		if ((!tmp) || (tmp->next==pom)) {
-			tmp = pom;
-			pom = pom->next;
-		} else {
-			free(pom->name);
-			free(pom);
-			tmp2 = tmp;
-			if (!tmp) pom=background->next;
-			else pom=tmp->next;
-			tmp = tmp2;
-		}
+void TM_Lookahead(int count, void (*callback)(struct TM_Action*, void*), void *data) {
+	struct TM_Action *pom = queue;
+	while ((pom) && (count-- > 0)) {
+		(*callback)(pom, data);
+		pom = pom->next;
 	}
-	tmp = NULL;
-	pom=background;
+	pom = background;
+	while (pom) {
+		(*callback)(pom, data);
+		pom = pom->next;
+	}
+}
+
+/*! \brief Destroys all actions from given list. */
+void DestroyActions(struct TM_Action *pom) {
+	struct TM_Action *tmp;
 	while (pom!=NULL) {
-		if (pom->active) {
+		if ((pom->active) || (pom->function == runinbackground)) {
 			if (*pom->function) (*pom->function)(game, pom, TM_ACTIONSTATE_DESTROY);
-			else {
-				if (pom->timer) al_destroy_timer(pom->timer);
-			}
 		} else {
 			TM_DestroyArgs(pom->arguments);
 			pom->arguments = NULL;
 		}
-		if ((!tmp) || (tmp->next==pom)) {
-			tmp = pom;
-			pom = pom->next;
-		} else {
-			free(pom->name);
-			free(pom);
-			tmp2 = tmp;
-			if (!tmp) pom=background->next;
-			else pom=tmp->next;
-			tmp = tmp2;
-		}
+		tmp = pom;
+		pom = pom->next;
+		free(tmp->name);
+		free(tmp);
 	}
-	
+}
+
+void TM_Destroy(void) {
+	if (!game) return;
+	PrintConsole(game, "Timeline Manager: destroy");
+	struct TM_Action *tmp = queue;
+	queue = NULL;
+	DestroyActions(tmp);
+	tmp = background;
+	background = NULL;
+	DestroyActions(tmp);
 	game = NULL;
 }
 
@@ -375,3 +347,56 @@ bool TM_Initialized(void) {
 	if (game) return true;
 	return false;
 }
+
+/*! \brief Describes state and cost of given action in human readable form. */
+void DescribeAction(struct TM_Action *action, bool queued, bool head, char* text, int size) {
+	char* state;
+	char remaining[32] = "";
+	if (action->ticks > 0) {
+		snprintf(remaining, sizeof(remaining), " %d ms left", action->ticks*1000/LOGIC_FPS);
+	}
+	if (!action->function) state = "delay";
+	else if (action->active) state = "running";
+	else if (action->ticks > 0) state = "delayed";
+	else if ((queued) && (!head)) state = "queued";
+	else state = "waiting";
+	snprintf(text, size, "%c %3d %-20.20s %-8s%-14s run %7.3f ms (peak %6.3f) draw %7.3f ms (peak %6.3f)", queued ? 'Q' : 'B', action->id, action->name, state, remaining, action->running_time*1000, action->running_peak*1000, action->draw_time*1000, action->draw_peak*1000);
+}
+
+void TM_DrawDebug(void) {
+	if (!game) return;
+	char text[255];
+	float height = al_get_font_line_height(game->font_console);
+	float y = game->viewportHeight*0.15;
+	int count = 0;
+	struct TM_Action *pom;
+	for (pom = queue; pom; pom = pom->next) count++;
+	for (pom = background; pom; pom = pom->next) count++;
+	al_draw_filled_rectangle(0, y, game->viewportWidth, y+(count+1)*height+height/2, al_map_rgba(0,0,0,160));
+	al_draw_textf(game->font_console, al_map_rgb(255,255,255), game->viewportWidth*0.005, y, ALLEGRO_ALIGN_LEFT, "Timeline Manager: %d actions", count);
+	for (pom = queue; pom; pom = pom->next) {
+		y += height;
+		DescribeAction(pom, true, pom==queue, text, sizeof(text));
+		al_draw_text(game->font_console, pom->active ? al_map_rgb(255,255,0) : al_map_rgb(255,255,255), game->viewportWidth*0.005, y, ALLEGRO_ALIGN_LEFT, text);
+	}
+	for (pom = background; pom; pom = pom->next) {
+		y += height;
+		DescribeAction(pom, false, false, text, sizeof(text));
+		al_draw_text(game->font_console, pom->active ? al_map_rgb(255,255,0) : al_map_rgb(192,192,192), game->viewportWidth*0.005, y, ALLEGRO_ALIGN_LEFT, text);
+	}
+}
+
+void TM_Dump(void) {
+	if (!game) return;
+	char text[255];
+	struct TM_Action *pom;
+	PrintConsole(game, "Timeline Manager: dump");
+	for (pom = queue; pom; pom = pom->next) {
+		DescribeAction(pom, true, pom==queue, text, sizeof(text));
+		PrintConsole(game, "%s", text);
+	}
+	for (pom = background; pom; pom = pom->next) {
+		DescribeAction(pom, false, false, text, sizeof(text));
+		PrintConsole(game, "%s", text);
+	}
+}
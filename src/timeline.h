@@ -44,12 +44,17 @@ struct TM_Arguments {
 struct TM_Action {
 		bool (*function)(struct Game*, struct TM_Action*, enum TM_ActionState); /*!< Function callback of the action. */
 		struct TM_Arguments *arguments; /*!< Arguments of the action. */
-		ALLEGRO_TIMER *timer; /*!< Delay timer. */
+		int ticks; /*!< Number of logic ticks left until delay is reached. */
 		bool active; /*!< If false, then this action is waiting for it's delay to finish. */
 		int delay; /*!< Number of miliseconds to delay before action is started. */
 		struct TM_Action *next; /*!< Pointer to next action in queue. */
 		unsigned int id; /*!< ID of the action. */
 		char* name; /*!< "User friendly" name of the action. */
+		int spritesheet; /*!< Handle of Derpy spritesheet the action is going to select, -1 if none. Set by action on INIT. */
+		double running_time; /*!< Accumulated time spent in RUNNING callbacks, in seconds. */
+		double running_peak; /*!< Longest single RUNNING callback, in seconds. */
+		double draw_time; /*!< Accumulated time spent in DRAW callbacks, in seconds. */
+		double draw_peak; /*!< Longest single DRAW callback, in seconds. */
 };
 
 /*! \brief Init timeline. */
@@ -62,14 +67,14 @@ void TM_Draw(void);
 void TM_Pause(void);
 /*! \brief Resumes timeline. */
 void TM_Resume(void);
-/*! \brief Handle timer events. */
-void TM_HandleEvent(ALLEGRO_EVENT *ev);
 /*! \brief Add new action to main queue. */
 struct TM_Action* TM_AddAction(bool (*func)(struct Game*, struct TM_Action*, enum TM_ActionState), struct TM_Arguments* args, char* name);
 /*! \brief Add new action to background queue. */
 struct TM_Action* TM_AddBackgroundAction(bool (*func)(struct Game*, struct TM_Action*, enum TM_ActionState), struct TM_Arguments* args, int delay, char* name);
 /*! \brief Add new action to main queue, which adds specified action into background queue. */
 struct TM_Action* TM_AddQueuedBackgroundAction(bool (*func)(struct Game*, struct TM_Action*, enum TM_ActionState), struct TM_Arguments* args, int delay, char* name);
+/*! \brief Calls callback for given number of actions at the front of main queue and for all background actions. */
+void TM_Lookahead(int count, void (*callback)(struct TM_Action*, void*), void *data);
 /*! \brief Add delay to main queue. */
 void TM_AddDelay(int delay);
 /*! \brief Destroy timeline. */
@@ -80,5 +85,9 @@ struct TM_Arguments* TM_AddToArgs(struct TM_Arguments* args, void* arg);
 void TM_DestroyArgs(struct TM_Arguments* args);
 /*! \brief Check if timeline is initialised. */
 bool TM_Initialized(void);
+/*! \brief Draws timeline inspector overlay with state and cost of every action. */
+void TM_DrawDebug(void);
+/*! \brief Prints state and cost of every action on game console. */
+void TM_Dump(void);
 
 #endif
@@ -0,0 +1,149 @@
+/*! \file tools/pack.c
+ *  \brief Tool packing data directory into memory-mapped archive.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "../archivefmt.h"
+
+/*! \brief File to be packed. */
+struct PackEntry {
+		char* name; /*!< Path relative to data directory, with forward slashes. */
+		char* path; /*!< Path on disk. */
+		unsigned int size; /*!< Size of file. */
+		unsigned int offset; /*!< Offset of data in archive. */
+};
+
+struct PackEntry *entries = NULL;
+int count = 0, allocated = 0;
+
+/*! \brief Adds every regular file under given directory to the list of entries. */
+void Scan(char* root, char* prefix) {
+	char dirpath[1024];
+	snprintf(dirpath, sizeof(dirpath), "%s/%s", root, prefix);
+	DIR *dir = opendir(dirpath);
+	struct dirent *ent;
+	if (!dir) {
+		fprintf(stderr, "Could not open directory %s!\n", dirpath);
+		exit(1);
+	}
+	while ((ent = readdir(dir))) {
+		char name[1024], path[2048];
+		struct stat st;
+		/* skip hidden files and build scripts */
+		if ((ent->d_name[0] == '.') || (!strcmp(ent->d_name, "CMakeLists.txt"))) continue;
+		snprintf(name, sizeof(name), "%s%s", prefix, ent->d_name);
+		snprintf(path, sizeof(path), "%s/%s", root, name);
+		if (stat(path, &st)) continue;
+		if (S_ISDIR(st.st_mode)) {
+			strcat(name, "/");
+			Scan(root, name);
+			continue;
+		}
+		if (!S_ISREG(st.st_mode)) continue;
+		if (count == allocated) {
+			allocated = allocated ? allocated * 2 : 128;
+			entries = realloc(entries, allocated * sizeof(struct PackEntry));
+		}
+		entries[count].name = strdup(name);
+		entries[count].path = strdup(path);
+		entries[count].size = st.st_size;
+		count++;
+	}
+	closedir(dir);
+}
+
+int CompareEntries(const void *a, const void *b) {
+	return strcmp(((const struct PackEntry*)a)->name, ((const struct PackEntry*)b)->name);
+}
+
+void WriteLE32(FILE *file, unsigned int value) {
+	fputc(value & 0xFF, file);
+	fputc((value >> 8) & 0xFF, file);
+	fputc((value >> 16) & 0xFF, file);
+	fputc((value >> 24) & 0xFF, file);
+}
+
+/*! \brief Pads file with zeros up to given offset. */
+void Pad(FILE *file, unsigned long offset) {
+	while ((unsigned long)ftell(file) < offset) fputc(0, file);
+}
+
+int main(int argc, char** argv) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s data_directory %s\n", argv[0], ARCHIVE_FILENAME);
+		return 1;
+	}
+	Scan(argv[1], "");
+	qsort(entries, count, sizeof(struct PackEntry), CompareEntries);
+
+	unsigned long names_size = 0, offset;
+	int i;
+	for (i=0; i<count; i++) names_size += strlen(entries[i].name) + 1;
+	offset = ARCHIVE_HEADER_SIZE + count * ARCHIVE_RECORD_SIZE + names_size;
+	for (i=0; i<count; i++) {
+		offset = (offset + ARCHIVE_ALIGN - 1) / ARCHIVE_ALIGN * ARCHIVE_ALIGN;
+		entries[i].offset = offset;
+		offset += entries[i].size;
+		if (offset > 0xFFFFFFFFul) {
+			fprintf(stderr, "Data doesn't fit in 4 GB archive!\n");
+			return 1;
+		}
+	}
+
+	FILE *file = fopen(argv[2], "wb");
+	if (!file) {
+		fprintf(stderr, "Could not open %s for writing!\n", argv[2]);
+		return 1;
+	}
+	fwrite(ARCHIVE_MAGIC, 1, 4, file);
+	WriteLE32(file, ARCHIVE_VERSION);
+	WriteLE32(file, count);
+	WriteLE32(file, names_size);
+	unsigned long name = 0;
+	for (i=0; i<count; i++) {
+		WriteLE32(file, name);
+		WriteLE32(file, entries[i].offset);
+		WriteLE32(file, entries[i].size);
+		WriteLE32(file, 0);
+		name += strlen(entries[i].name) + 1;
+	}
+	for (i=0; i<count; i++) fwrite(entries[i].name, 1, strlen(entries[i].name) + 1, file);
+	for (i=0; i<count; i++) {
+		char buffer[65536];
+		size_t size;
+		FILE *in = fopen(entries[i].path, "rb");
+		if (!in) {
+			fprintf(stderr, "Could not open %s!\n", entries[i].path);
+			return 1;
+		}
+		Pad(file, entries[i].offset);
+		while ((size = fread(buffer, 1, sizeof(buffer), in))) fwrite(buffer, 1, size, file);
+		fclose(in);
+	}
+	if (fclose(file)) {
+		fprintf(stderr, "Could not write %s!\n", argv[2]);
+		return 1;
+	}
+	printf("Packed %d files (%lu bytes) into %s.\n", count, offset, argv[2]);
+	return 0;
+}
@@ -0,0 +1,297 @@
+/*! \file track.c
+ *  \brief Memory accounting and leak tracking code.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <stdio.h>
+#include <stdint.h>
+/* wrappers call real allocation functions */
+#define TRACK_IMPLEMENTATION
+#include "main.h"
+
+#ifdef MEMTRACK
+
+/*! \brief Initial number of slots in allocation table. Always a power of two. */
+#define TRACK_INITIAL_SLOTS 4096
+/*! \brief Maximum number of distinct tags shown by Track_Dump. */
+#define TRACK_DUMP_TAGS 32
+
+/*! \brief Live allocation, stored in open addressing hash table keyed by its pointer. */
+struct TrackEntry {
+		void* ptr; /*!< Allocated memory or resource, NULL for empty slot. */
+		size_t size; /*!< Estimated memory footprint, in bytes. */
+		const char* tag; /*!< Tag of allocating thread at the time of allocation, usually name of gamestate. */
+		const char* file; /*!< Source file of the allocation. */
+		int line; /*!< Source line of the allocation. */
+		enum track_kind_enum kind; /*!< Kind of allocation. */
+		bool reported; /*!< True if allocation has been already reported as leaked by its tag. */
+};
+
+/*! \brief Human readable names of allocation kinds. */
+char* track_kind_names[] = { "heap", "bitmap", "sample", "font" };
+
+struct TrackEntry *track_entries = NULL;
+size_t track_slots = 0, track_used = 0;
+size_t track_count[TRACK_KINDS] = { }, track_bytes[TRACK_KINDS] = { };
+ALLEGRO_MUTEX *track_mutex = NULL;
+__thread const char* track_tag = NULL;
+
+void TrackLock(void) {
+	/* first allocation happens on main thread, before any other thread is started */
+	if (!track_mutex) track_mutex = al_create_mutex();
+	al_lock_mutex(track_mutex);
+}
+
+void TrackUnlock(void) {
+	al_unlock_mutex(track_mutex);
+}
+
+/*! \brief Returns first slot to probe for given pointer. */
+size_t TrackSlot(void* ptr) {
+	uintptr_t hash = (uintptr_t)ptr;
+	hash ^= hash >> 16;
+	hash *= 0x45d9f3b;
+	hash ^= hash >> 16;
+	return hash & (track_slots-1);
+}
+
+/*! \brief Returns slot holding given pointer, or empty slot where it should be inserted. */
+size_t TrackFind(void* ptr) {
+	size_t i = TrackSlot(ptr);
+	while ((track_entries[i].ptr) && (track_entries[i].ptr != ptr)) {
+		i = (i+1) & (track_slots-1);
+	}
+	return i;
+}
+
+/*! \brief Doubles size of allocation table, rehashing all entries. */
+void TrackGrow(void) {
+	struct TrackEntry *old = track_entries;
+	size_t i, slots = track_slots;
+	track_slots = slots ? slots*2 : TRACK_INITIAL_SLOTS;
+	track_entries = calloc(track_slots, sizeof(struct TrackEntry));
+	for (i=0; i<slots; i++) {
+		if (old[i].ptr) track_entries[TrackFind(old[i].ptr)] = old[i];
+	}
+	free(old);
+}
+
+/*! \brief Records allocation. Must be called with the lock held. */
+void TrackAdd(void* ptr, enum track_kind_enum kind, size_t size, const char* file, int line) {
+	if (!ptr) return;
+	if ((track_used+1)*2 > track_slots) TrackGrow();
+	struct TrackEntry *entry = &track_entries[TrackFind(ptr)];
+	if (!entry->ptr) track_used++;
+	else {
+		/* memory freed behind our back, e.g. by a library */
+		track_count[entry->kind]--;
+		track_bytes[entry->kind] -= entry->size;
+	}
+	entry->ptr = ptr;
+	entry->size = size;
+	entry->tag = track_tag;
+	entry->file = file;
+	entry->line = line;
+	entry->kind = kind;
+	entry->reported = false;
+	track_count[kind]++;
+	track_bytes[kind] += size;
+}
+
+/*! \brief Forgets allocation, if it's tracked. Must be called with the lock held. */
+void TrackRemove(void* ptr) {
+	if ((!ptr) || (!track_slots)) return;
+	size_t i = TrackFind(ptr), j = i;
+	if (!track_entries[i].ptr) return;
+	track_count[track_entries[i].kind]--;
+	track_bytes[track_entries[i].kind] -= track_entries[i].size;
+	track_entries[i].ptr = NULL;
+	track_used--;
+	/* shift following entries back, so probing never stops at the hole */
+	while (true) {
+		j = (j+1) & (track_slots-1);
+		if (!track_entries[j].ptr) break;
+		size_t k = TrackSlot(track_entries[j].ptr);
+		if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j))) continue;
+		track_entries[i] = track_entries[j];
+		track_entries[j].ptr = NULL;
+		i = j;
+	}
+}
+
+/*! \brief Records allocation, taking the lock. */
+void* TrackAddLocked(void* ptr, enum track_kind_enum kind, size_t size, const char* file, int line) {
+	TrackLock();
+	TrackAdd(ptr, kind, size, file, line);
+	TrackUnlock();
+	return ptr;
+}
+
+/*! \brief Forgets allocation, taking the lock. */
+void TrackRemoveLocked(void* ptr) {
+	TrackLock();
+	TrackRemove(ptr);
+	TrackUnlock();
+}
+
+const char* Track_SetTag(const char* tag) {
+	const char* old = track_tag;
+	track_tag = tag;
+	return old;
+}
+
+void Track_Retag(void* ptr, const char* tag) {
+	if ((!ptr) || (!track_slots)) return;
+	TrackLock();
+	struct TrackEntry *entry = &track_entries[TrackFind(ptr)];
+	if (entry->ptr) {
+		entry->tag = tag;
+		entry->reported = false;
+	}
+	TrackUnlock();
+}
+
+int Track_Report(struct Game *game, const char* tag) {
+	int count = 0;
+	size_t i, bytes = 0;
+	TrackLock();
+	for (i=0; i<track_slots; i++) {
+		struct TrackEntry *entry = &track_entries[i];
+		if (!entry->ptr) continue;
+		if (tag) {
+			if ((entry->reported) || (!entry->tag) || (strcmp(entry->tag, tag))) continue;
+			entry->reported = true;
+		}
+		fprintf(stderr, "Track: leaked %s of %zu bytes allocated at %s:%d (%s)\n", track_kind_names[entry->kind], entry->size, entry->file, entry->line, entry->tag ? entry->tag : "untagged");
+		count++;
+		bytes += entry->size;
+	}
+	TrackUnlock();
+	if (!count) return 0;
+	/* shutdown report is printed after the console is gone */
+	if (game) PrintConsole(game, "Track: %d allocations (%zu kB) leaked by %s", count, bytes/1024, tag ? tag : "the game");
+	else fprintf(stderr, "Track: %d allocations (%zu kB) still alive\n", count, bytes/1024);
+	return count;
+}
+
+void Track_Dump(struct Game *game) {
+	const char* tags[TRACK_DUMP_TAGS];
+	int tag_count[TRACK_DUMP_TAGS] = { }, tags_used = 0, i;
+	size_t tag_bytes[TRACK_DUMP_TAGS] = { }, count[TRACK_KINDS], bytes[TRACK_KINDS], j;
+	TrackLock();
+	memcpy(count, track_count, sizeof(count));
+	memcpy(bytes, track_bytes, sizeof(bytes));
+	for (j=0; j<track_slots; j++) {
+		struct TrackEntry *entry = &track_entries[j];
+		if (!entry->ptr) continue;
+		const char* tag = entry->tag ? entry->tag : "untagged";
+		for (i=0; i<tags_used; i++) {
+			if (!strcmp(tags[i], tag)) break;
+		}
+		if (i == tags_used) {
+			if (tags_used == TRACK_DUMP_TAGS) continue;
+			tags[tags_used++] = tag;
+		}
+		tag_count[i]++;
+		tag_bytes[i] += entry->size;
+	}
+	TrackUnlock();
+	for (i=0; i<tags_used; i++) {
+		PrintConsole(game, "Track: %s: %d allocations, %zu kB", tags[i], tag_count[i], tag_bytes[i]/1024);
+	}
+	for (i=0; i<TRACK_KINDS; i++) {
+		PrintConsole(game, "Track: %s: %zu live, %zu kB", track_kind_names[i], count[i], bytes[i]/1024);
+	}
+}
+
+void* Track_Malloc(size_t size, const char* file, int line) {
+	return TrackAddLocked(malloc(size), TRACK_HEAP, size, file, line);
+}
+
+void* Track_Calloc(size_t count, size_t size, const char* file, int line) {
+	return TrackAddLocked(calloc(count, size), TRACK_HEAP, count*size, file, line);
+}
+
+void* Track_Realloc(void* ptr, size_t size, const char* file, int line) {
+	/* freed block may be handed out to another thread right away, so keep the table locked */
+	TrackLock();
+	void* result = realloc(ptr, size);
+	if ((result) || (!size)) TrackRemove(ptr);
+	TrackAdd(result, TRACK_HEAP, size, file, line);
+	TrackUnlock();
+	return result;
+}
+
+char* Track_Strdup(const char* str, const char* file, int line) {
+	return TrackAddLocked(strdup(str), TRACK_HEAP, strlen(str)+1, file, line);
+}
+
+void Track_Free(void* ptr) {
+	TrackRemoveLocked(ptr);
+	free(ptr);
+}
+
+/*! \brief Estimates memory footprint of bitmap. */
+size_t TrackBitmapSize(ALLEGRO_BITMAP* bitmap) {
+	if (!bitmap) return 0;
+	return (size_t)al_get_bitmap_width(bitmap)*al_get_bitmap_height(bitmap)*4;
+}
+
+ALLEGRO_BITMAP* Track_CreateBitmap(int w, int h, const char* file, int line) {
+	ALLEGRO_BITMAP* bitmap = al_create_bitmap(w, h);
+	return TrackAddLocked(bitmap, TRACK_BITMAP, TrackBitmapSize(bitmap), file, line);
+}
+
+ALLEGRO_BITMAP* Track_LoadBitmap(const char* filename, const char* file, int line) {
+	ALLEGRO_BITMAP* bitmap = al_load_bitmap(filename);
+	return TrackAddLocked(bitmap, TRACK_BITMAP, TrackBitmapSize(bitmap), file, line);
+}
+
+ALLEGRO_BITMAP* Track_CloneBitmap(ALLEGRO_BITMAP* source, const char* file, int line) {
+	ALLEGRO_BITMAP* bitmap = al_clone_bitmap(source);
+	return TrackAddLocked(bitmap, TRACK_BITMAP, TrackBitmapSize(bitmap), file, line);
+}
+
+void Track_DestroyBitmap(ALLEGRO_BITMAP* bitmap) {
+	TrackRemoveLocked(bitmap);
+	al_destroy_bitmap(bitmap);
+}
+
+ALLEGRO_SAMPLE* Track_LoadSample(const char* filename, const char* file, int line) {
+	ALLEGRO_SAMPLE* sample = al_load_sample(filename);
+	size_t size = 0;
+	if (sample) size = al_get_sample_length(sample) * al_get_channel_count(al_get_sample_channels(sample)) * al_get_audio_depth_size(al_get_sample_depth(sample));
+	return TrackAddLocked(sample, TRACK_SAMPLE, size, file, line);
+}
+
+void Track_DestroySample(ALLEGRO_SAMPLE* sample) {
+	TrackRemoveLocked(sample);
+	al_destroy_sample(sample);
+}
+
+ALLEGRO_FONT* Track_LoadTTFFont(const char* filename, int size, int flags, const char* file, int line) {
+	/* glyph pages are allocated by the addon on demand, so only fonts themselves are counted */
+	return TrackAddLocked(al_load_ttf_font(filename, size, flags), TRACK_FONT, 0, file, line);
+}
+
+void Track_DestroyFont(ALLEGRO_FONT* font) {
+	TrackRemoveLocked(font);
+	al_destroy_font(font);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/*! \file track.h
+ *  \brief Memory accounting and leak tracking headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef TRACK_H
+#define TRACK_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_audio.h>
+#include <allegro5/allegro_font.h>
+#include <allegro5/allegro_ttf.h>
+
+struct Game;
+
+#ifdef MEMTRACK
+
+/*! \brief Kinds of tracked allocations. */
+enum track_kind_enum {
+	TRACK_HEAP,
+	TRACK_BITMAP,
+	TRACK_SAMPLE,
+	TRACK_FONT,
+	TRACK_KINDS
+};
+
+/*! \brief Sets tag given to allocations made by current thread from now on, returning previous one. */
+const char* Track_SetTag(const char* tag);
+/*! \brief Moves tracked allocation under given tag, e.g. when it's handed over to asset manager. */
+void Track_Retag(void* ptr, const char* tag);
+/*! \brief Prints allocations with given tag which are still alive, or all of them if tag is NULL.
+ *
+ * Allocations already reported with their tag are skipped, unless every allocation is asked for.
+ * Returns number of reported allocations.
+ */
+int Track_Report(struct Game *game, const char* tag);
+/*! \brief Prints live bytes and counts of tracked allocations, by kind and by tag, on game console. */
+void Track_Dump(struct Game *game);
+
+void* Track_Malloc(size_t size, const char* file, int line);
+void* Track_Calloc(size_t count, size_t size, const char* file, int line);
+void* Track_Realloc(void* ptr, size_t size, const char* file, int line);
+char* Track_Strdup(const char* str, const char* file, int line);
+void Track_Free(void* ptr);
+ALLEGRO_BITMAP* Track_CreateBitmap(int w, int h, const char* file, int line);
+ALLEGRO_BITMAP* Track_LoadBitmap(const char* filename, const char* file, int line);
+ALLEGRO_BITMAP* Track_CloneBitmap(ALLEGRO_BITMAP* bitmap, const char* file, int line);
+void Track_DestroyBitmap(ALLEGRO_BITMAP* bitmap);
+ALLEGRO_SAMPLE* Track_LoadSample(const char* filename, const char* file, int line);
+void Track_DestroySample(ALLEGRO_SAMPLE* sample);
+ALLEGRO_FONT* Track_LoadTTFFont(const char* filename, int size, int flags, const char* file, int line);
+void Track_DestroyFont(ALLEGRO_FONT* font);
+
+/* every header declaring wrapped functions has to be included above */
+#ifndef TRACK_IMPLEMENTATION
+#define malloc(size) Track_Malloc((size), __FILE__, __LINE__)
+#define calloc(count, size) Track_Calloc((count), (size), __FILE__, __LINE__)
+#define realloc(ptr, size) Track_Realloc((ptr), (size), __FILE__, __LINE__)
+#define strdup(str) Track_Strdup((str), __FILE__, __LINE__)
+#define free(ptr) Track_Free(ptr)
+#define al_create_bitmap(w, h) Track_CreateBitmap((w), (h), __FILE__, __LINE__)
+#define al_load_bitmap(filename) Track_LoadBitmap((filename), __FILE__, __LINE__)
+#define al_clone_bitmap(bitmap) Track_CloneBitmap((bitmap), __FILE__, __LINE__)
+#define al_destroy_bitmap(bitmap) Track_DestroyBitmap(bitmap)
+#define al_load_sample(filename) Track_LoadSample((filename), __FILE__, __LINE__)
+#define al_destroy_sample(sample) Track_DestroySample(sample)
+#define al_load_ttf_font(filename, size, flags) Track_LoadTTFFont((filename), (size), (flags), __FILE__, __LINE__)
+#define al_destroy_font(font) Track_DestroyFont(font)
+#endif
+
+#else
+
+static inline const char* Track_SetTag(const char* tag) { return NULL; }
+static inline void Track_Retag(void* ptr, const char* tag) {}
+static inline int Track_Report(struct Game *game, const char* tag) { return 0; }
+static inline void Track_Dump(struct Game *game) {}
+
+#endif
+
+#endif
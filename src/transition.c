@@ -0,0 +1,111 @@
+/*! \file transition.c
+ *  \brief Gamestate transitions code.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#include <allegro5/allegro_primitives.h>
+#include "bake.h"
+#include "pool.h"
+#include "transition.h"
+
+/*! \brief Calculates weights of the snapshot and of the black cover, as seen on screen right now. */
+void TransitionWeights(struct Game *game, float *snapshot, float *black) {
+	float t = game->transition.t;
+	if (game->transition.mode == TRANSITION_OUT) {
+		*snapshot = 1-t;
+		*black = t;
+	} else if (game->transition.mode == TRANSITION_IN) {
+		*snapshot = game->transition.snapshot_weight * (1-t);
+		*black = game->transition.black_weight * (1-t);
+	} else {
+		*snapshot = 0;
+		*black = 0;
+	}
+}
+
+void Transition_Out(struct Game *game) {
+	/* nothing is shown while baking */
+	if ((!game->display) || (Bake_Active())) return;
+	ALLEGRO_BITMAP *backbuffer = al_get_backbuffer(game->display);
+	/* previous snapshot may still be on screen, so it's given back only after the new one is taken */
+	ALLEGRO_BITMAP *previous = game->transition.snapshot;
+	ALLEGRO_BITMAP *snapshot = Pool_Acquire(game, game->viewportWidth, game->viewportHeight);
+
+	/* frame is drawn the usual way, together with transition in progress, and copied from letterboxed viewport */
+	al_set_target_bitmap(backbuffer);
+	DrawGameState(game);
+	float x = 0, y = 0;
+	al_transform_coordinates(al_get_current_transform(), &x, &y);
+	al_set_target_bitmap(snapshot);
+	al_draw_bitmap_region(backbuffer, x, y, game->viewportWidth, game->viewportHeight, 0, 0, 0);
+	al_set_target_bitmap(backbuffer);
+	game->transition.snapshot = snapshot;
+	Pool_Release(game, previous);
+
+	game->transition.mode = TRANSITION_OUT;
+	game->transition.t = 0;
+}
+
+void Transition_In(struct Game *game) {
+	if ((!game->display) || (Bake_Active())) return;
+	float snapshot, black;
+	if (game->transition.mode == TRANSITION_NONE) {
+		snapshot = 0;
+		black = 1;
+	} else {
+		/* continue from whatever is on screen, so interrupted fade out turns into crossfade */
+		TransitionWeights(game, &snapshot, &black);
+	}
+	game->transition.snapshot_weight = snapshot;
+	game->transition.black_weight = black;
+	game->transition.mode = TRANSITION_IN;
+	game->transition.t = 0;
+}
+
+void Transition_Logic(struct Game *game) {
+	if (game->transition.mode == TRANSITION_NONE) return;
+	game->transition.t += TRANSITION_STEP;
+	if (game->transition.t < 1) return;
+	game->transition.t = 1;
+	if (game->transition.mode != TRANSITION_IN) return;
+	game->transition.mode = TRANSITION_NONE;
+	Pool_Release(game, game->transition.snapshot);
+	game->transition.snapshot = NULL;
+}
+
+void Transition_Draw(struct Game *game) {
+	float snapshot, black;
+	if (game->transition.mode == TRANSITION_NONE) return;
+	TransitionWeights(game, &snapshot, &black);
+	/* snapshot is drawn under black cover, so its alpha makes up for the part covered */
+	if ((snapshot > 0) && (black < 1) && (game->transition.snapshot)) {
+		float alpha = snapshot / (1-black);
+		al_draw_tinted_bitmap(game->transition.snapshot, al_map_rgba_f(alpha, alpha, alpha, alpha), 0, 0, 0);
+	}
+	if (black > 0) al_draw_filled_rectangle(0, 0, game->viewportWidth, game->viewportHeight, al_map_rgba_f(0, 0, 0, black));
+}
+
+bool Transition_Active(struct Game *game) {
+	return (game->transition.mode == TRANSITION_IN) || ((game->transition.mode == TRANSITION_OUT) && (game->transition.t < 1));
+}
+
+void Transition_Destroy(struct Game *game) {
+	Pool_Release(game, game->transition.snapshot);
+	game->transition.snapshot = NULL;
+	game->transition.mode = TRANSITION_NONE;
+}
@@ -0,0 +1,52 @@
+/*! \file transition.h
+ *  \brief Gamestate transitions headers.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+#ifndef TRANSITION_H
+#define TRANSITION_H
+
+#include "main.h"
+
+/*! \brief Progress of transition made on every logic tick. */
+#define TRANSITION_STEP (10/255.0)
+
+/*! \brief Kind of transition in progress. */
+enum transition_enum {
+	TRANSITION_NONE, /*!< Nothing is covering current gamestate. */
+	TRANSITION_OUT, /*!< Snapshot of leaving gamestate fades to black, and stays black when it's done. */
+	TRANSITION_IN /*!< Whatever covers current gamestate fades away. */
+};
+
+/*! \brief Takes snapshot of current frame and starts fading it to black.
+ *
+ * Leaving gamestate can be unloaded right after that, as only its snapshot is shown from now on.
+ */
+void Transition_Out(struct Game *game);
+/*! \brief Starts revealing current gamestate - crossfading from snapshot of the previous one, or fading from black if there's none. */
+void Transition_In(struct Game *game);
+/*! \brief Advances transition by one logic tick. */
+void Transition_Logic(struct Game *game);
+/*! \brief Draws transition over current gamestate. */
+void Transition_Draw(struct Game *game);
+/*! \brief Checks if transition is still in progress. Finished fade out doesn't count. */
+bool Transition_Active(struct Game *game);
+/*! \brief Gives snapshot target back to the pool. */
+void Transition_Destroy(struct Game *game);
+
+#endif